@@ -0,0 +1,52 @@
+#include <cstdlib>
+#include <new>
+#include "profiler.hpp"
+
+// Replaces the global allocator to count allocations per thread. Only the
+// plain forms are replaced: the array and nothrow forms forward to them,
+// and over-aligned allocations are rare enough to leave uncounted.
+
+namespace cb::profile {
+
+namespace {
+
+thread_local uint64_t allocationCount = 0;
+thread_local uint64_t allocationBytes = 0;
+thread_local int untrackedDepth = 0;
+
+}
+
+AllocationCount threadAllocations()
+{
+    return AllocationCount{ allocationCount, allocationBytes };
+}
+
+Untracked::Untracked() { ++untrackedDepth; }
+Untracked::~Untracked() { --untrackedDepth; }
+
+}
+
+#ifdef CB_PROFILING
+
+void* operator new(std::size_t size)
+{
+    if (cb::profile::untrackedDepth == 0)
+    {
+        ++cb::profile::allocationCount;
+        cb::profile::allocationBytes += size;
+    }
+    if (void* memory = std::malloc(size ? size : 1)) return memory;
+    throw std::bad_alloc();
+}
+
+void operator delete(void* memory) noexcept
+{
+    std::free(memory);
+}
+
+void operator delete(void* memory, std::size_t) noexcept
+{
+    std::free(memory);
+}
+
+#endif
@@ -0,0 +1,152 @@
+#include "animation.hpp"
+#include <algorithm>
+#include <cmath>
+
+namespace cb {
+
+std::vector<sf::Vector2f>& AnimationScheduler::enqueue(int uid, float delay, float duration, Easing easing, bool rejected)
+{
+    grow(uid);
+    float start = clock + std::max(delay, 0.0f);
+    const bool first = ends[uid] == idle;
+    if (!first) start = std::max(start, ends[uid]);
+    ends[uid] = start + duration;
+
+    Track& track = tracks.emplace_back();
+    track.uid = uid;
+    track.start = start;
+    track.duration = std::max(duration, 1e-3f);
+    track.easing = easing;
+    track.rejected = rejected;
+    track.leading = first;
+    track.route = takeRoute();
+    return track.route;
+}
+
+// Advances every track at once, drops the finished ones and marks which of
+// the rest each chip is showing.
+void AnimationScheduler::update(float dt)
+{
+    if (tracks.empty()) return;
+    clock += dt;
+
+    // Stamps start over before the counter wraps into values still stored
+    if (++pass == 0)
+    {
+        std::fill(shown.begin(), shown.end(), 0u);
+        pass = 1;
+    }
+
+    std::size_t kept = 0;
+    for (std::size_t i = 0; i < tracks.size(); ++i)
+    {
+        Track& track = tracks[i];
+        if (clock >= track.start + track.duration)
+        {
+            // A chip's last track is the one that ends last
+            if (clock >= ends[track.uid]) ends[track.uid] = idle;
+            spare.push_back(std::move(track.route));
+            continue;
+        }
+        track.leading = shown[track.uid] != pass;
+        shown[track.uid] = pass;
+        if (kept != i) tracks[kept] = std::move(track);
+        ++kept;
+    }
+    tracks.resize(kept);
+
+    // Keeps float precision from running out over a long session
+    if (tracks.empty()) clock = 0.0f;
+}
+
+void AnimationScheduler::cancel(int uid)
+{
+    if (!isMoving(uid)) return;
+    ends[uid] = idle;
+    std::size_t kept = 0;
+    for (std::size_t i = 0; i < tracks.size(); ++i)
+    {
+        if (tracks[i].uid == uid)
+        {
+            spare.push_back(std::move(tracks[i].route));
+            continue;
+        }
+        if (kept != i) tracks[kept] = std::move(tracks[i]);
+        ++kept;
+    }
+    tracks.resize(kept);
+}
+
+void AnimationScheduler::clear()
+{
+    for (Track& track : tracks) spare.push_back(std::move(track.route));
+    tracks.clear();
+    std::fill(ends.begin(), ends.end(), idle);
+    clock = 0.0f;
+}
+
+void AnimationScheduler::reserve(std::size_t uidCount)
+{
+    if (uidCount <= ends.size()) return;
+    ends.resize(uidCount, idle);
+    shown.resize(uidCount, 0u);
+    tracks.reserve(uidCount);
+}
+
+void AnimationScheduler::capture(std::vector<ChipMotion>& motions, std::vector<sf::Vector2f>& trail) const
+{
+    motions.clear();
+    trail.clear();
+    for (const Track& track : tracks)
+    {
+        if (!track.leading || track.route.empty()) continue;
+
+        const float t = std::clamp((clock - track.start) / track.duration, 0.0f, 1.0f);
+        const float eased = track.easing ? track.easing(t) : t;
+
+        ChipMotion& motion = motions.emplace_back();
+        motion.uid = track.uid;
+        motion.rejected = track.rejected;
+        motion.position = along(track.route, t > 0.0f ? eased : 0.0f);
+        motion.trailStart = static_cast<uint32_t>(trail.size());
+        if (track.rejected || t <= 0.0f || track.route.size() < 2) continue;
+
+        motion.fade = 1.0f - std::pow(t, 0.1f);
+        for (std::size_t i = 0; i < trailSteps; ++i)
+        {
+            const float trailT = eased - i * trailSpacing;
+            if (trailT < 0.0f) break;
+            trail.push_back(along(track.route, trailT));
+        }
+        motion.trailCount = static_cast<uint32_t>(trail.size()) - motion.trailStart;
+    }
+}
+
+// Route nodes are spaced evenly in t, as the single drag animation had them
+sf::Vector2f AnimationScheduler::along(const std::vector<sf::Vector2f>& route, float t)
+{
+    const std::size_t last = route.size() - 1;
+    const float scaled = std::clamp(t, 0.0f, 1.0f) * static_cast<float>(last);
+    const std::size_t segment = std::min(static_cast<std::size_t>(scaled), last);
+    const sf::Vector2f& a = route[segment];
+    const sf::Vector2f& b = route[std::min(segment + 1, last)];
+    return a + (b - a) * (scaled - static_cast<float>(segment));
+}
+
+// Only for uids past what reserve() was told, which a loaded level never has
+void AnimationScheduler::grow(int uid)
+{
+    const std::size_t needed = static_cast<std::size_t>(uid) + 1;
+    if (needed > ends.size()) reserve(std::max(needed, 2 * ends.size()));
+}
+
+std::vector<sf::Vector2f> AnimationScheduler::takeRoute()
+{
+    if (spare.empty()) return {};
+    std::vector<sf::Vector2f> route = std::move(spare.back());
+    spare.pop_back();
+    route.clear();
+    return route;
+}
+
+}
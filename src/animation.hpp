@@ -0,0 +1,68 @@
+#pragma once
+#include <SFML/Graphics.hpp>
+#include <cstdint>
+#include <vector>
+#include "snapshot.hpp"
+
+namespace cb {
+
+// Chip moves in flight. Each move is a track with its own route, timing and
+// easing; tracks of different chips overlap freely, while a chip's own
+// tracks play one after another. The puzzle has already made the move when
+// it is queued, so tracks only say where to draw a chip until they end.
+// Finished tracks hand their route buffers back for the next ones, and
+// per-chip state lives in arrays indexed by uid that reserve() sizes when a
+// level loads, so a long playback stops allocating once it is under way.
+class AnimationScheduler
+{
+    public:
+        using Easing = float (*)(float);
+
+        // Queues a move that starts `delay` seconds from now, or when the
+        // chip's previous move ends if that is later. Returns the track's
+        // route, empty, for the caller to fill with world positions before
+        // queueing another; a rejected move is the one point the chip stays
+        // at, drawn in the error colour.
+        std::vector<sf::Vector2f>& enqueue(int uid, float delay, float duration, Easing, bool rejected = false);
+        void update(float dt);
+        void cancel(int uid);                           // the chip shows where the puzzle has it
+        void clear();
+        void reserve(std::size_t uidCount);             // chip uids are below uidCount
+
+        bool isEmpty() const { return tracks.empty(); }
+        bool isMoving(int uid) const { return uid >= 0 && static_cast<std::size_t>(uid) < ends.size() && ends[uid] >= 0.0f; }
+
+        // One motion per chip with tracks: along its current move, or at
+        // the start of its next one while it waits.
+        void capture(std::vector<ChipMotion>&, std::vector<sf::Vector2f>& trail) const;
+
+        static constexpr std::size_t trailSteps = 32;
+        static constexpr float trailSpacing = 0.025f;   // eased route fraction between trail sprites
+
+    private:
+        struct Track
+        {
+            int uid = -1;
+            float start = 0.0f;                         // on the scheduler's clock
+            float duration = 1.0f;
+            Easing easing = nullptr;
+            bool rejected = false;
+            bool leading = false;                       // earliest of its chip's tracks
+            std::vector<sf::Vector2f> route;
+        };
+
+        static sf::Vector2f along(const std::vector<sf::Vector2f>&, float t);
+        std::vector<sf::Vector2f> takeRoute();
+        void grow(int uid);
+
+        static constexpr float idle = -1.0f;            // ends entry of a chip without tracks
+
+        std::vector<Track> tracks;                      // in queue order, so per chip in start order
+        std::vector<std::vector<sf::Vector2f>> spare;   // route buffers of finished tracks
+        std::vector<float> ends;                        // per chip uid: end of its last track, or idle
+        std::vector<uint32_t> shown;                    // per chip uid: last update() that saw a track of it
+        uint32_t pass = 0;
+        float clock = 0.0f;
+};
+
+}
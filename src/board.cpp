@@ -1,11 +1,13 @@
 #include "board.hpp"
 #include <cstdint>
-#include <iostream>
+#include <filesystem>
 #include "colours.hpp"
 
 namespace cb {
 
-Board::Board(const sf::Vector2f& wsize): wsize(wsize) 
+Board::Board(const sf::Vector2f& wsize, bool headless)
+    : wsize(wsize), camera(wsize), headless(headless), loader(wsize, colorset), level(std::make_shared<Level>()),
+      renderer(colorset, headless)
 {
     levelButtons = {
         Button({20.f, 20.f},  {15.0f, 15.0f}),
@@ -20,317 +22,27 @@ Board::Board(const sf::Vector2f& wsize): wsize(wsize)
     levelButtons[0].normalColor = hexColor(color::Material::Green);
     levelButtons[1].normalColor = hexColor(color::Material::Yellow);
     levelButtons[2].normalColor = hexColor(color::Material::Red);
-};
-
-Chip* Board::getChipByUid(int uid)
-{
-    for(Chip& chip : chips)
-    {
-        if(chip.uid == uid) return &chip;
-    }
-    return nullptr;
-}
-
-void Board::bake()
-{
-    bakedConnections.clear();
-    bakedHoneycombs.clear();
-    // Connections
-    {
-        std::set<std::pair<int, int>> bakedPairs;
-        for (const auto& [from, neighbors] : adjacency)
-        {
-            for (auto to : neighbors)
-            {
-                auto connection = std::minmax(from, to);
-                if (bakedPairs.count(connection)) continue;
-
-                bakedPairs.insert(connection);
-
-                const Node& p1 = node.at(connection.first);
-                const Node& p2 = node.at(connection.second);
-
-                PolyLine line
-                (
-                    sf::Vector2f(p1.x, p1.y),
-                    sf::Vector2f(p2.x, p2.y),
-                    8, // thickness
-                    4, // step
-                    colorset.foreground,
-                    colorset.background
-                );
-                bakedConnections.push_back(std::move(line));
-            }
-        }
-    }
-
-    // Base nodes
-    for (const auto& [id, pt] : node)
-    {
-        if (pt.type == Node::Base)
-        {
-            Honeycomb honeycomb
-            (
-                sf::Vector2f{68.f, 68.f}, // cell size
-                4.0f,                     // gap
-                colorset.foreground,
-                colorset.background
-            );
-            honeycomb.setPosition(sf::Vector2f{pt.x, pt.y});
-            bakedHoneycombs.push_back(std::move(honeycomb));
-        }
-    }
-
-    // Intersections
-    for (const auto& [id, pt] : node)
-    {
-        if (pt.type == Node::Intersection)
-        {
-            Honeycomb honeycomb
-            (
-                sf::Vector2f{48.f, 48.f}, // cell size
-                4.0f,                     // gap
-                colorset.foreground,
-                colorset.background
-            );
-            honeycomb.setPosition(sf::Vector2f{pt.x, pt.y});
-            bakedHoneycombs.push_back(std::move(honeycomb));
-        }
-    }
-
-    bakeChipTextures();
-    bakeHintTextures();
-}
-
-
-void Board::addPoint(uint32_t uid, int x, int y)
-{
-    node[uid] = Node{ uid, static_cast<float>(x), static_cast<float>(y) };
-}
-
-void Board::addConnection(int from, int to)
-{
-    adjacency[from].push_back(to);
-    adjacency[to].push_back(from); // bidirectional
-}
-
-void Board::placeChip(uint32_t chipId, int pointId)
-{
-    const Node& pt = node.at(pointId);
-    Chip chip{ chipId, pointId };
-    chips.push_back(chip);
-}
-
-void Board::setTargetPositions(const std::vector<int>& targets)
-{
-    targetPositions = targets;
-}
-
-void Board::bakeChipTextures(float cellSize)
-{
-    chipTextures.clear();
-    const int texSize{static_cast<int>(cellSize * 8.0f)};
-
-    for (const Chip& chip : chips)
-    {
-        auto texture = bakeIdenticonTexture<5>(chip.uid, cellSize);
-        chipTextures[chip.uid] = texture;
-    }
-}
-
-void Board::bakeHintTextures(float cellSize)
-{
-    for (std::size_t i = 0; i < chips.size(); ++i)
-    {
-        if (i >= targetPositions.size()) break;
-        auto texture = bakeIdenticonTexture<5>
-        (
-            chips[i].uid,
-            cellSize,
-            false,
-            sf::Color::White
-        );
-        hintTextures[chips[i].uid] = texture;
-    }
-}
-
-void Board::drawChips(sf::RenderTarget& target) const
-{
-    float scale = 1.0f;
-    for (const Chip& chip : chips)
-    {
-        if (drag.animating && chip.uid == drag.uid) continue;
-        if (drag.active && !drag.animating && chip.uid == drag.uid) continue;
-
-        auto position = node.find(chip.position);
-        if(position == node.end()) continue;
-
-        auto texture = chipTextures.find(chip.uid);
-        if (texture == chipTextures.end()) continue;
-
-        sf::Sprite sprite{*texture->second};
-
-        sf::FloatRect bounds{ sprite.getLocalBounds() }; 
-        sprite.setOrigin(sf::Vector2f{bounds.size.x / 2.0f, bounds.size.y / 2.0f}); 
-        sprite.setPosition(sf::Vector2f{ position->second.x, position->second.y }); 
-        sprite.setScale(sf::Vector2f{chipScale, chipScale});
-
-        target.draw(sprite);
-    }
-}
-
-void Board::drawDraggedChip(sf::RenderTarget& target) const
-{
-    if (!drag.active && !drag.animating) return;
-
-    auto it = chipTextures.find(drag.uid);
-    if (it == chipTextures.end()) return;
 
-    sf::Sprite sprite{ *it->second };
-    sprite.setOrigin({ sprite.getLocalBounds().size.x * 0.5f, sprite.getLocalBounds().size.y * 0.5f });
-    sf::Vector2f pos;
-    if(drag.active && !drag.animating)
+    for (const char* builtin : builtinLevels)
     {
-        sf::Color tint = colorset.selected;
-        pos = drag.mousePosition - drag.offset;
-
-        if (drag.target != -1)
-        {
-            if (auto itPt = node.find(drag.target); itPt != node.end())
-                pos = { itPt->second.x, itPt->second.y };
-        }
-
-        sprite.setColor(tint);
-        sprite.setScale({ chipScale, chipScale });
-    }
-    else if (drag.animating)
-    {
-        float t = std::clamp(drag.phase, 0.0f, 1.0f);
-        float easedT = easeOutBounce(t);
-
-        if (!drag.route.empty())
-        {
-            size_t segCount = drag.route.size() - 1;
-            size_t seg = static_cast<size_t>(easedT * segCount);
-            float localT = (easedT * segCount) - seg;
-
-            const auto& a = drag.route[seg];
-            const auto& b = drag.route[std::min(seg + 1, segCount)];
-            pos = a + (b - a) * localT;
-
-            // Trail
-            constexpr size_t trailSteps = 32;
-            constexpr float trailSpacing = 0.025f;
-
-            for (size_t i = 0; i < trailSteps; ++i)
-            {
-                float trailT = easedT - i * trailSpacing;
-                if (trailT < 0.0f) break;
-
-                size_t trailSeg = static_cast<size_t>(trailT * segCount);
-                float trailLocalT = (trailT * segCount) - trailSeg;
-
-                const auto& ta = drag.route[trailSeg];
-                const auto& tb = drag.route[std::min(trailSeg + 1, segCount)];
-                sf::Vector2f trailPos = ta + (tb - ta) * trailLocalT;
-
-                sf::Sprite trail{ *it->second };
-                trail.setOrigin({ trail.getLocalBounds().size.x * 0.5f, trail.getLocalBounds().size.y * 0.5f });
-                trail.setPosition(trailPos);
-
-                float age = static_cast<float>(i) / trailSteps;
-                float alpha = 128.0f * ( 1.0f - std::pow(drag.phase, 0.1f));
-                float scale = chipScale * (1.0f - age);
-
-                trail.setScale({ scale, scale });
-                trail.setColor(sf::Color(255, 255, 255, static_cast<uint8_t>(alpha)));
-
-                target.draw(trail);
-            }
-        }
-        else
-        {
-            pos = drag.snapback;
-            sprite.setColor(colorset.error);
-        }
-
-        sprite.setScale({ chipScale, chipScale });
-    }
-    else
-    {
-        if (drag.path.empty()) return;
-        pos = drag.mousePosition;
-
-        if (drag.target != -1)
-        {
-            if (auto itPt = node.find(drag.target); itPt != node.end())
-                pos = { itPt->second.x, itPt->second.y };
-
-            for (const auto& chip : chips)
-                if (chip.position == drag.target && chip.uid != drag.uid)
-                    return;
-        }
-
-        sprite.setColor(colorset.selected);
-        sprite.setScale({ chipScale * 0.8f, chipScale * 0.8f });
+        playlist.emplace_back(builtin, false);
+        playlistKeys.push_back(Level::makeKey(builtin, false));
     }
 
-    sprite.setPosition(pos);
-    target.draw(sprite);
-}
+};
 
-void Board::drawHints(sf::RenderTarget& target) const
+void Board::queryVisibleNodes(const sf::FloatRect& area) const
 {
-    float centerY = 0.0f;
-    for (const auto& [_, point] : node)
-    {
-        centerY += static_cast<float>(point.y);
-    }
-    centerY /= static_cast<float>(node.size());
-
-    for (size_t i = 0; i < chips.size(); ++i)
-    {
-        if (i >= targetPositions.size()) continue;
-
-        const int targetId = targetPositions[i];
-        const Chip& chip = chips[i];
-
-        auto itPoint   = node.find(targetId);
-        auto itTexture = hintTextures.find(chip.uid);
-
-        if (itPoint == node.end() || itTexture == hintTextures.end()) continue;
-
-        const sf::Vector2f pos
-        {
-            static_cast<float>(itPoint->second.x),
-            static_cast<float>(itPoint->second.y) + ((itPoint->second.y < centerY) ? -64.0f : +64.0f)
-        };
-
-        sf::Sprite sprite{ *itTexture->second };
-        const sf::FloatRect bounds = sprite.getLocalBounds();
-
-        sprite.setOrigin(sf::Vector2f{ bounds.size.x / 2.0f, bounds.size.y / 2.0f });
-        sprite.setPosition(pos);
-        sprite.setScale(sf::Vector2f{ hintScale, hintScale });
-
-        if (chip.position == targetId)
-        {
-            sprite.setColor(colorset.activeHint);
-        }
-        else
-        {
-            sprite.setColor(colorset.inactiveHint);
-        }
-
-        target.draw(sprite);
-    }
+    visible.clear();
+    level->honeycombGrid.query(area, visible);
 }
 
-void Board::mouseDown(const sf::Vector2f& mousePos)
+void Board::mouseDown(const sf::Vector2f& pixel)
 {
+    CB_PROFILE_ALLOCATIONS("mouseDown");
     for (auto& button : levelButtons)
     {
-        if (button.contains(mousePos))
+        if (button.contains(camera.toScreen(pixel)))
         {
             button.onClick();
             return;
@@ -340,48 +52,39 @@ void Board::mouseDown(const sf::Vector2f& mousePos)
     drag.active = false;
     constexpr float cellSize = 48.0f;
     constexpr float radius = 24.0f;
+    const sf::Vector2f mousePos = camera.toWorld(pixel);
 
-    for (const auto& chip : chips)
+    queryVisibleNodes(sf::FloatRect{ mousePos - sf::Vector2f{ cellSize, cellSize }, sf::Vector2f{ 2.0f * cellSize, 2.0f * cellSize } });
+    for (uint32_t index : visible)
     {
-        auto itPoint = node.find(chip.position);
-        auto itTexture = chipTextures.find(chip.uid);
-        if (itPoint == node.end() || itTexture == chipTextures.end()) continue;
+        const int occupant = level->puzzle.chipAt(level->honeycombNode[index]);
+        if (occupant == -1) continue;
+        const Chip& chip = level->puzzle.getChips()[occupant];
+
+        const Node* itPoint = level->puzzle.findNode(chip.position);
+        if (itPoint == nullptr) continue;
 
-        sf::Vector2f chipPos{ itPoint->second.x, itPoint->second.y };
+        sf::Vector2f chipPos{ itPoint->x, itPoint->y };
 
         if (distance(mousePos, chipPos) < radius)
         {
             drag.active = true;
             drag.uid = chip.uid;
+            animations.cancel(drag.uid);
             drag.origin = chip.position;
             drag.mousePosition = mousePos;
             drag.offset = mousePos - chipPos;
             return;
         }
 
-        sf::Sprite sprite{ *itTexture->second };
-        sprite.setOrigin
-        (
-            sf::Vector2f
-            {
-                sprite.getLocalBounds().size.x * 0.5f,
-                sprite.getLocalBounds().size.y * 0.5f
-            }
-        );
-        sprite.setScale
-        (
-            sf::Vector2f
-            {
-                cellSize / static_cast<float>(itTexture->second->getSize().x), 
-                cellSize / static_cast<float>(itTexture->second->getSize().x)
-            }
-        );
-        sprite.setPosition(chipPos);
-
-        if (sprite.getGlobalBounds().contains(mousePos))
+        // The chip sprite's footprint at cell size; geometry only, so the
+        // same test works headless without textures
+        const sf::FloatRect footprint{ chipPos - sf::Vector2f{ cellSize, cellSize } * 0.5f, sf::Vector2f{ cellSize, cellSize } };
+        if (footprint.contains(mousePos))
         {
             drag.active = true;
             drag.uid = chip.uid;
+            animations.cancel(drag.uid);
             drag.origin = chip.position;
             drag.mousePosition = mousePos;
             drag.offset = mousePos - chipPos;
@@ -392,30 +95,32 @@ void Board::mouseDown(const sf::Vector2f& mousePos)
     drag.uid = std::numeric_limits<std::size_t>::max();
 }
 
-void Board::mouseMove(const sf::Vector2f& mp)
+void Board::mouseMove(const sf::Vector2f& pixel)
 {
+    CB_PROFILE_ALLOCATIONS("mouseMove");
     if (!drag.active) return;
 
-    drag.mousePosition = mp;
-    drag.target = -1;
+    drag.mousePosition = camera.toWorld(pixel);
+    drag.resolved = false;
+}
 
-    float minDist = std::numeric_limits<float>::max();
+// Hover target and path for the latest mouse position; deferred from
+// mouseMove so any number of moves in a frame cost one search.
+void Board::resolveDrag()
+{
+    if (!drag.active || drag.resolved) return;
+    CB_PROFILE_SCOPE("resolveDrag");
+    drag.resolved = true;
+    drag.target = -1;
 
-    for (const auto& [id, pt] : node)
+    if (int nearest = level->honeycombGrid.nearest(drag.mousePosition); nearest != -1)
     {
-        sf::Vector2f ptPos{static_cast<float>(pt.x), static_cast<float>(pt.y)};
-        float dist = std::hypot(mp.x - ptPos.x, mp.y - ptPos.y);
-
-        if (dist < minDist)
-        {
-            minDist = dist;
-            drag.target = id;
-        }
+        drag.target = level->honeycombNode[nearest];
     }
 
     if (drag.target != -1)
     {
-        drag.path = findPath(drag.origin, drag.target);
+        level->puzzle.findRoute(drag.origin, drag.target, drag.path, drag.uid);
     }
     else
     {
@@ -425,282 +130,519 @@ void Board::mouseMove(const sf::Vector2f& mp)
 
 void Board::mouseUp()
 {
+    CB_PROFILE_ALLOCATIONS("mouseUp");
     if (!drag.active) return;
+    resolveDrag();
 
-    std::vector<int> path = findPath(drag.origin, drag.target);
-
-    drag.phase = 0.0f;
-    drag.active = false;
-
-    Chip* draggedChip = getChipByUid(drag.uid);
-    if (!draggedChip) return;
-
-    if (!path.empty())
+    const int chip = level->puzzle.chipIndex(drag.uid);
+    if (chip != -1 && !drag.path.empty())
     {
-        drag.animating = true;
-        drag.route.clear();
-
-        for (int id : path)
+        std::vector<sf::Vector2f>& route = animations.enqueue(drag.uid, 0.0f, moveDuration, easeOutBounce);
+        for (int id : drag.path)
         {
-            const Node& pt = node.at(id);
-            drag.route.push_back(sf::Vector2f{ pt.x, pt.y });
+            const Node& pt = level->puzzle.node(id);
+            route.push_back(sf::Vector2f{ pt.x, pt.y });
         }
-        draggedChip->position = drag.target;
+        level->puzzle.place(chip, drag.target);
     }
-    else
+    else if (chip != -1)
     {
-        draggedChip->position = drag.origin;
-        drag.target = -1;
+        const Node& pt = level->puzzle.node(level->puzzle.getChips()[chip].position);
+        animations.enqueue(drag.uid, 0.0f, moveDuration, easeOutBounce, true).push_back(sf::Vector2f{ pt.x, pt.y });
     }
-
-    drag.animating = true;
-
-    const Node& pt = node.at(draggedChip->position);
-    drag.snapback = sf::Vector2f{ pt.x, pt.y };
+    drag.reset();
 }
 
 void Board::update(float delta)
 {
-    if(drag.animating)
+    CB_PROFILE_ALLOCATIONS("update");
+    receiveLevel();
+    updateTextureResolution();
+
+    const bool baking = !level->isBaked() || incoming || prefetching;
+    if (baking || memoryDirty)
     {
-        drag.phase += delta;
-        if (drag.phase > 1.0f)
-        {
-            drag = DragState{};
-        }
-        return;
+        measureMemory();
+        enforceMemoryBudget();
     }
+    memoryDirty = baking;                               // once more after a bake ends
+
+    resolveDrag();
+    animations.update(delta);
+    if (playbackSpeed > 0.0f) queueSolution();
 }
 
-void Board::draw(sf::RenderTarget& target, float scale, bool debug, sf::Vector2f mousePos)
+void Board::playSolution(float speed)
 {
-    update(0.02f);
-    for (const PolyLine& line : bakedConnections)
-        target.draw(line);
+    if (scripted || editor.isActive() || speed <= 0.0f) return;
+    playbackSpeed = speed;
+    playbackStates = 0;
+    playbackNotice.clear();
+    if (!hints.isStarted()) hints.start(level->puzzle);
+}
+
+std::string Board::status() const
+{
+    if (editor.isActive()) return editor.status();
+    if (playbackSpeed > 0.0f) return "finding a solution";
+    if (!playbackNotice.empty() && level->puzzle.hash() == playbackNoticeHash) return playbackNotice;
+    return {};
+}
 
-    for (const Honeycomb& honeycomb : bakedHoneycombs)
-        target.draw(honeycomb);
+// Queues every move of the hint engine's solution from the current state at
+// once: the puzzle jumps to solved and the scheduler plays the moves out,
+// each starting a spacing after the last, overlapping where chips differ.
+// Waits for the backward search to reach the board first, looking again
+// only as the table grows, and gives up once the search has stopped short.
+void Board::queueSolution()
+{
+    Puzzle& puzzle = level->puzzle;
+    const bool finished = hints.isFinished();
+    const std::size_t states = hints.states();
+    if (states == playbackStates && !finished) return;
+    playbackStates = states;
+
+    if (hints.distance(puzzle) < 0)
+    {
+        if (!finished) return;
+        playbackSpeed = 0.0f;
+        playbackNotice = hints.isComplete() ? "not solvable from here" : "no solution known from here, try a hint";
+        playbackNoticeHash = puzzle.hash();
+        return;
+    }
+    CB_PROFILE_SCOPE("queueSolution");
 
-    if (drag.active && !drag.path.empty())
+    const float duration = playbackDuration / playbackSpeed;
+    const float spacing = playbackSpacing / playbackSpeed;
+    float delay = 0.0f;
+    while (const std::optional<Move> move = hints.hint(puzzle))
     {
-        sf::VertexArray pathLine(sf::PrimitiveType::LineStrip, drag.path.size());
+        const int chip = puzzle.chipIndex(move->chip);
+        if (chip == -1 || !puzzle.findRoute(puzzle.getChips()[chip].position, move->to, playbackPath, move->chip)) break;
 
-        for (size_t i = 0; i < drag.path.size(); ++i)
+        std::vector<sf::Vector2f>& route = animations.enqueue(move->chip, delay, duration, easeInOutCubic);
+        for (int id : playbackPath)
         {
-            auto it = node.find(drag.path[i]);
-            if (it == node.end()) continue;
-
-            sf::Vector2f pos(it->second.x, it->second.y);
-            pathLine[i].position = pos; 
-            pathLine[i].color = colorset.path;
+            const Node& pt = puzzle.node(id);
+            route.push_back(sf::Vector2f{ pt.x, pt.y });
         }
-
-        target.draw(pathLine);
+        puzzle.place(chip, move->to);
+        delay += spacing;
     }
+    playbackSpeed = 0.0f;
+}
 
-    drawHints(target);        
-    drawChips(target);        
-    drawDraggedChip(target);  
-    for (auto& button : levelButtons)
-    {
-        button.draw(target);
-    }
+void Board::draw(sf::RenderTarget& target, bool debug)
+{
+    capture(frame);
+    renderer.draw(target, frame, debug);
 }
 
-std::vector<int> Board::findPath(int start, int goal) const
+void Board::capture(BoardSnapshot& snapshot)
 {
-    std::unordered_map<int, int> cameFrom;
-    std::set<int> visited{ start };
-    std::vector<int> queue{ start };
+    CB_PROFILE_SCOPE("capture");
+    CB_PROFILE_ALLOCATIONS("capture");
+    resolveDrag();
+
+    const Puzzle& puzzle = level->puzzle;
+    snapshot.level = level;
+    snapshot.textures = level->textures;
+    snapshot.chips.resize(puzzle.getChips().size());
+    for (std::size_t i = 0; i < snapshot.chips.size(); ++i)
+    {
+        const Chip& chip = puzzle.getChips()[i];
+        snapshot.chips[i] = ChipView{ static_cast<int>(chip.uid), chip.position, animations.isMoving(static_cast<int>(chip.uid)) };
+    }
+    snapshot.occupant = puzzle.getOccupants();
+    snapshot.drag = drag;
+    animations.capture(snapshot.motions, snapshot.trail);
+    captureSuggestion(snapshot.suggestion);
+
+    snapshot.buttons.resize(levelButtons.size());
+    for (std::size_t i = 0; i < levelButtons.size(); ++i)
+        snapshot.buttons[i] = ButtonView{ levelButtons[i].position, levelButtons[i].size, levelButtons[i].color() };
+
+    editor.capture(snapshot.editor);
+    snapshot.memory = memory;
+    snapshot.view = camera.getView();
+    snapshot.zoom = camera.getZoom();
+    snapshot.sequence = ++captures;
+}
 
-    while (!queue.empty())
-    {
-        int current = queue.front();
-        queue.erase(queue.begin());
+// Route of the hinted move; searched here, on the simulation side, since
+// the puzzle's search scratch isn't shared with the renderer.
+void Board::captureSuggestion(std::vector<int>& route)
+{
+    route.clear();
+    if (!showHints || drag.active || !animations.isEmpty()) return;
+    CB_PROFILE_SCOPE("suggestion");
 
-        if (current == goal) break;
+    const std::optional<Move> move = hints.hint(level->puzzle);
+    if (!move) return;
 
-        auto it = adjacency.find(current);
-        if (it == adjacency.end()) continue;
+    const int chip = level->puzzle.chipIndex(move->chip);
+    if (chip == -1) return;
+    if (!level->puzzle.findRoute(level->puzzle.getChips()[chip].position, move->to, route, move->chip)) route.clear();
+}
 
-        for (int neighbor : it->second)
-        {
-            if (visited.count(neighbor)) continue;
+void Board::resetView()
+{
+    camera.fit(level->boardBounds);
+}
 
-            bool occupied = std::any_of(chips.begin(), chips.end(),
-                [&](const Chip& chip) { return chip.position == neighbor && chip.uid != drag.uid; });
+void Board::toggleHints()
+{
+    showHints = !showHints;
+    if (showHints && !hints.isStarted()) hints.start(level->puzzle);
+}
 
-            if (occupied) continue;
+void Board::loadLevel(const std::string& filename, bool external)
+{
+    if (scripted) return;
+    const std::string key = Level::makeKey(filename, external);
+    updatePlaylist(filename, external);
+    revision = Revision::None;
 
-            visited.insert(neighbor);
-            cameFrom[neighbor] = current;
-            queue.push_back(neighbor);
+    if (auto cached = cache.take(key))
+    {
+        cached->reset();
+        if (cached->textures || headless)
+        {
+            swapIn(std::move(cached));
+            return;
         }
+        // Its identicons were shed for memory: the current level stays
+        // in play while they bake again
+        cached->requestResolution(textureResolution(camera.zoomToFit(cached->boardBounds)));
+        incoming = std::move(cached);
+        wanted = key;
+        return;
     }
 
-    bool goalOccupied = std::any_of(chips.begin(), chips.end(),
-        [&](const Chip& chip) { return chip.position == goal && chip.uid != drag.uid; });
+    if (prefetching && prefetching->key() == key && prefetching->isStale()) prefetching.reset();
+    if (prefetching && prefetching->key() == key)
+    {
+        incoming = std::move(prefetching);
+        wanted = key;
+        return;
+    }
 
-    if (goalOccupied || cameFrom.find(goal) == cameFrom.end())
-        return {};
+    wanted = key;
+    incoming.reset();
+    loader.request(filename, external);
+}
+
+void Board::reviseLevel()
+{
+    if (level->source.empty()) return;
+    reviseLevel(level->source, level->external, Revision::File);
+}
 
-    std::vector<int> path;
-    int current = goal;
-    while (current != start)
+void Board::reviseLevel(const std::string& source, bool external, Revision kind)
+{
+    if (scripted) return;
+    if (!wanted.empty() && revision == Revision::None) return;     // on the way to another level
+
+    // Whatever was cached or prefetched for this key is out of date now
+    const std::string key = Level::makeKey(source, external);
+    cache.take(key);
+    if (prefetching && prefetching->key() == key) prefetching.reset();
+
+    wanted = key;
+    revision = kind;
+    incoming.reset();
+    loader.request(source, external, level);
+}
+
+void Board::toggleEditing()
+{
+    if (scripted) return;
+    if (editor.isActive())
     {
-        path.push_back(current);
-        current = cameFrom[current];
+        editor.end();
+        return;
     }
+    level->reset();
+    drag.reset();
+    animations.clear();
+    playbackSpeed = 0.0f;
+    editor.begin(*level);
+}
 
-    path.push_back(start);
-    std::reverse(path.begin(), path.end());
-    return path;
+void Board::editPress(const sf::Vector2f& pixel, bool connect)
+{
+    const sf::Vector2f world = camera.toWorld(pixel);
+    if (editor.press(world, connect)) applyEdit();
 }
 
-void Board::clear()
+void Board::editMove(const sf::Vector2f& pixel)
 {
-    chips.clear();
-    node.clear();
-    adjacency.clear();
-    targetPositions.clear();
-    bakedConnections.clear();
-    bakedHoneycombs.clear();
-    chipTextures.clear();
-    hintTextures.clear();
+    editor.drag(camera.toWorld(pixel));
+}
 
-    drag = DragState{};
+void Board::editRelease()
+{
+    if (editor.release()) applyEdit();
 }
 
-void Board::loadLevel(const std::string& filename, bool external)
+void Board::edit(Edit command)
 {
-    clear();
-    if(external)
+    bool changed = false;
+    switch (command)
     {
-        std::ifstream file(filename);
-        if (!file.is_open()) {
-            std::cerr << "Failed to open file: " << filename << "\n";
-            return;
-        }
-        loadFromStream(file);
+        case Edit::Remove:      changed = editor.removeSelected(); break;
+        case Edit::ToggleStart: changed = editor.toggleStart(); break;
+        case Edit::SetTarget:   changed = editor.setTarget(); break;
     }
-    else 
+    if (changed) applyEdit();
+}
+
+// Every edit is a revision of the level as text; the loader rebuilds only
+// what it touched, and a newer edit supersedes one still loading.
+void Board::applyEdit()
+{
+    reviseLevel(editor.source(), false, Revision::Edit);
+}
+
+void Board::loadLevelNow(const std::string& filename, bool external)
+{
+    auto next = Level::load(filename, external, wsize, colorset);
+    if (!next) return;
+
+    if (headless) next->skipTextures();
+    else
     {
-        std::istringstream stream(filename);
-        loadFromStream(stream);
+        next->requestResolution(textureResolution(camera.zoomToFit(next->boardBounds)));
+        next->bakeTextures(identicons, std::numeric_limits<float>::max());
     }
 
+    updatePlaylist(filename, external);
+    swapIn(std::move(next));
 }
 
-void Board::loadFromStream(std::istream& file)
+void Board::stepLevel(int step)
 {
-    std::string line;
+    if (playlist.empty()) return;
+    const int count = static_cast<int>(playlist.size());
+    const int next = ((current < 0 ? 0 : current + step) % count + count) % count;
+    loadLevel(playlist[next].first, playlist[next].second);
+}
 
-    auto nextLine = [&]() -> bool {
-        while (std::getline(file, line)) {
-            if (!line.empty()) return true;
+// Built-in levels step among themselves, a level file among the files next
+// to it with the same extension.
+void Board::updatePlaylist(const std::string& source, bool external)
+{
+    auto found = std::find(playlist.begin(), playlist.end(), std::make_pair(source, external));
+    if (found == playlist.end())
+    {
+        playlist.clear();
+        if (external)
+        {
+            namespace fs = std::filesystem;
+            const fs::path path{ source };
+            std::error_code error;
+            const fs::path directory = path.has_parent_path() ? path.parent_path() : fs::path{ "." };
+            for (const auto& entry : fs::directory_iterator(directory, error))
+            {
+                if (entry.is_regular_file(error) && entry.path().extension() == path.extension())
+                    playlist.emplace_back(entry.path().string(), true);
+            }
+            std::sort(playlist.begin(), playlist.end());
         }
-        return false;
-    };
+        else
+        {
+            for (const char* builtin : builtinLevels)
+                playlist.emplace_back(builtin, false);
+        }
+        found = std::find(playlist.begin(), playlist.end(), std::make_pair(source, external));
+        if (found == playlist.end())
+            found = playlist.insert(playlist.end(), std::make_pair(source, external));
 
-    int chipCount = 0;
-    int pointCount = 0;
+        playlistKeys.clear();
+        for (const auto& [entry, file] : playlist)
+            playlistKeys.push_back(Level::makeKey(entry, file));
+    }
+    current = static_cast<int>(found - playlist.begin());
+    prefetchAttempted.clear();
+}
 
-    if (nextLine()) chipCount = std::stoi(line);
-    if (nextLine()) pointCount = std::stoi(line);
+void Board::swapIn(std::shared_ptr<Level> next)
+{
+    // A half-done rebake is dropped; the cache keeps the set in use. An
+    // old version of a revised level isn't worth keeping.
+    if (level->textures) level->requestResolution(level->textureResolution());
+    if (!level->source.empty() && revision == Revision::None) cache.insert(std::move(level));
+
+    // Edits lay out starting positions, so chips show there
+    if (revision == Revision::File) carryChips(level->puzzle, next->puzzle);
+    level = std::move(next);
+    wanted.clear();
+    memoryDirty = true;
+    drag.reset();
+    animations.clear();
+    std::size_t uids = 0;
+    for (const Chip& chip : level->puzzle.getChips()) uids = std::max<std::size_t>(uids, chip.uid + 1);
+    animations.reserve(uids);
+    playbackSpeed = 0.0f;
+    if (revision == Revision::None) resetView();
+    if (editor.isActive())
+    {
+        if (revision != Revision::Edit) editor.begin(*level);
+        else editor.check(level->puzzle);
+    }
+    revision = Revision::None;
+
+    hints.stop();
+    if (showHints) hints.start(level->puzzle);
+
+    if (onLevelActivated) onLevelActivated(*level);
+}
 
-    for (int i = 0; i < pointCount; ++i)
+// Puts chips of a revised level back where the player had them, as far as
+// their nodes still exist and are free. Repeated because a chip's old node
+// may be the new starting node of one that hasn't moved back yet.
+void Board::carryChips(const Puzzle& from, Puzzle& to)
+{
+    bool moved = true;
+    while (moved)
     {
-        if (!nextLine()) break;
-        auto commaPos = line.find(',');
-        if (commaPos == std::string::npos) continue;
+        moved = false;
+        for (std::size_t i = 0; i < to.getChips().size(); ++i)
+        {
+            const int was = from.chipIndex(static_cast<int>(to.getChips()[i].uid));
+            if (was < 0) continue;
+            const int position = from.getChips()[was].position;
+            if (position == to.getChips()[i].position || !to.findNode(position) || to.isOccupied(position)) continue;
+            to.place(i, position);
+            moved = true;
+        }
+    }
+}
 
-        int x = std::stoi(line.substr(0, commaPos));
-        int y = std::stoi(line.substr(commaPos + 1));
-        addPoint(i + 1, x, y);
+// Finishes the requested level first, texture slice by texture slice; only
+// when nothing is pending does prefetched work get a (smaller) slice.
+void Board::receiveLevel()
+{
+    if (scripted) return;
+    if (auto next = loader.poll())
+    {
+        // A revision is drawn at the current zoom with the current
+        // level's textures; only new chips need baking
+        if (revision != Revision::None && next->key() == wanted) next->adoptTextures(*level);
+        else if (!headless) next->requestResolution(textureResolution(camera.zoomToFit(next->boardBounds)));
+        if (next->key() == wanted) incoming = std::move(next);
+        else prefetching = std::move(next);
     }
 
-    std::vector<int> initialPositions;
-    if (nextLine())
+    // A level that doesn't load, say a watched file saved half way through
+    // an edit, leaves the current one in play
+    const std::string failed = loader.pollFailure();
+    if (!failed.empty() && failed == wanted)
     {
-        std::istringstream initStream(line);
-        std::string token;
-        int chipId = 0;
+        wanted.clear();
+        revision = Revision::None;
+    }
 
-        while (std::getline(initStream, token, ','))
-        {
-            if (token.empty()) continue;
-            int pointId = std::stoi(token);
-            initialPositions.push_back(pointId);
-            placeChip(++chipId, pointId);
-        }
+    if (headless)
+    {
+        if (incoming) incoming->skipTextures();
+        if (prefetching) prefetching->skipTextures();
     }
 
-    targetPositions.clear();
-    if (nextLine())
+    if (incoming)
     {
-        std::istringstream targetStream(line);
-        std::string token;
+        if (incoming->bakeTextures(identicons, textureBudget)) swapIn(std::move(incoming));
+        return;
+    }
+    if (!wanted.empty()) return;
 
-        while (std::getline(targetStream, token, ','))
+    if (prefetching)
+    {
+        if (prefetching->bakeTextures(identicons, prefetchBudget))
         {
-            if (token.empty()) continue;
-            int targetPoint = std::stoi(token);
-            targetPositions.push_back(targetPoint);
+            cache.insert(std::move(prefetching));
+            prefetching.reset();
         }
+        return;
     }
 
-    int connectionCount = 0;
-    if (nextLine()) connectionCount = std::stoi(line);
+    prefetchNeighbours();
+}
 
-    for (int i = 0; i < connectionCount; ++i)
-    {
-        if (!nextLine()) break;
-        auto commaPos = line.find(',');
-        if (commaPos == std::string::npos) continue;
+// Circle diameter in pixels at this zoom, rounded up to a tier.
+unsigned Board::textureResolution(float zoom) const
+{
+    const float pixels = Level::chipDiameter / zoom * pixelScale;
+    unsigned tier = minResolution;
+    while (tier < pixels && tier < resolutionCap) tier *= 2;
+    return tier;
+}
 
-        int from = std::stoi(line.substr(0, commaPos));
-        int to = std::stoi(line.substr(commaPos + 1));
-        addConnection(from, to);
-    }
+// Any time the zoom needs more pixels the next tier is baked. A finer tier
+// than needed looks right through its mipmaps, so it's only given up for a
+// coarser one once it is four times too fine, to save memory.
+void Board::updateTextureResolution()
+{
+    if (headless || incoming) return;
 
-    for (auto& [id, pt] : node) pt.type = Node::Intersection;
-    for (int targetId : targetPositions)
-    {
-        if (auto it = node.find(targetId); it != node.end())
-            it->second.type = Node::Base;
-    }
+    const unsigned wanted = textureResolution(camera.getZoom());
+    const unsigned have = level->textureResolution();
+    if (have != 0 && have <= resolutionCap && wanted <= have && wanted * 4 > have) level->requestResolution(have);
+    else level->requestResolution(wanted);
 
-    float minX = std::numeric_limits<float>::max();
-    float maxX = std::numeric_limits<float>::lowest();
-    float minY = std::numeric_limits<float>::max();
-    float maxY = std::numeric_limits<float>::lowest();
+    if (!level->isBaked()) level->bakeTextures(identicons, textureBudget);
+}
 
-    for (const auto& [_, pt] : node)
+void Board::measureMemory()
+{
+    measured.clear();
+    memory = MemoryUsage{};
+    level->measure(memory, measured);
+    if (incoming) incoming->measure(memory, measured);
+    if (prefetching) prefetching->measure(memory, measured);
+    cache.forEach([this](const Level& cached) { cached.measure(memory, measured); });
+}
+
+// Only identicons can give way: geometry is what the level is. The cap
+// goes back up a tier once the current level's set would fit at the next
+// one, counting the old set and the canvas while it bakes, so it doesn't
+// swing back and forth.
+void Board::enforceMemoryBudget()
+{
+    if (memoryBudget == 0) return;
+
+    if (memory.textureTotal() > memoryBudget && cache.shedTextures(memory.textureTotal() - memoryBudget) > 0)
+        measureMemory();
+
+    if (memory.textureTotal() > memoryBudget)
     {
-        minX = std::min(minX, pt.x);
-        maxX = std::max(maxX, pt.x);
-        minY = std::min(minY, pt.y);
-        maxY = std::max(maxY, pt.y);
+        if (resolutionCap > minResolution) resolutionCap /= 2;
+        return;
     }
 
-    const sf::Vector2f boardCenter = {
-        (minX + maxX) / 2.0f,
-        (minY + maxY) / 2.0f
-    };
+    if (resolutionCap < maxResolution && level->isBaked() && !incoming)
+    {
+        const std::size_t current = level->textures ? level->textures->memoryBytes() : 0;
+        if (level->textureResolution() == resolutionCap && memory.textureTotal() + 4 * current + identiconCanvasBytes(resolutionCap * 2) <= memoryBudget)
+            resolutionCap *= 2;
+    }
+}
 
-    const sf::Vector2f windowCenter = {
-        wsize.x / 2.0f,
-        wsize.y / 2.0f
-    };
+void Board::prefetchNeighbours()
+{
+    if (current < 0 || loader.busy()) return;
 
-    const sf::Vector2f boardOffset = windowCenter - boardCenter;
-    for (auto& [_, pt] : node)
+    const int count = static_cast<int>(playlist.size());
+    for (int step : { +1, -1 })
     {
-        pt.x += boardOffset.x;
-        pt.y += boardOffset.y;
-    }
+        const int neighbour = ((current + step) % count + count) % count;
+        const std::string& key = playlistKeys[neighbour];
+        if (neighbour == current || cache.contains(key) || prefetchAttempted.count(key)) continue;
 
-    bake();
+        prefetchAttempted.insert(key);
+        loader.request(playlist[neighbour].first, playlist[neighbour].second);
+        return;
+    }
 }
 
 }
@@ -1,105 +1,175 @@
 #pragma once
 #include <cstdint>
 #include <unordered_map>
+#include <unordered_set>
 #include <string>
 #include <fstream>
 #include <algorithm>
+#include <memory>
 #include <set>
-#include "polyline.hpp"
-#include "honeycomb.hpp"
-#include "identicon.hpp"
+#include <functional>
 #include "colours.hpp"
 #include "levels.hpp"
 #include "button.hpp"
+#include "profiler.hpp"
+#include "camera.hpp"
+#include "level.hpp"
+#include "loader.hpp"
+#include "level_cache.hpp"
+#include "core/hints.hpp"
+#include "renderer.hpp"
+#include "snapshot.hpp"
+#include "editor.hpp"
+#include "animation.hpp"
 
 namespace cb {
 
-struct Node
-{
-    enum Type { Base, Intersection };
-    uint32_t uid;
-    float x;
-    float y;
-    Type type;
-};
-
-struct Chip
-{
-    uint32_t uid;
-    int position; // current location
-};
-
-struct Colorset 
-{
-    sf::Color background    { hexColor(color::Material::Background) };
-    sf::Color foreground    { hexColor(color::Material::Blue)       };
-    sf::Color inactiveHint  { hexColor(color::Material::Disabled)   };
-    sf::Color activeHint    { hexColor(color::Material::Blue)       };
-    sf::Color path          { hexColor(color::Material::Purple)     };
-    sf::Color selected      { hexColor(color::Material::Purple)     };
-    sf::Color error         { hexColor(color::Material::Error)      };
-};
-
-struct DragState
-{
-    bool active = false;
-    bool animating = false;
-    int uid = -1;
-    int origin = -1;
-    int target = -1;                            // hovered sector
-    float phase = 0.0f;                         // [0.0 ... 1.0]
-    sf::Vector2f mousePosition;
-    sf::Vector2f snapback;
-    std::vector<int> path;
-    std::vector<sf::Vector2f> route;    // actual positions
-    sf::Vector2f offset;
-};
-
-
 class Board
 {
     public:
-        Board(const sf::Vector2f&);
-        void draw(sf::RenderTarget&, float, bool, sf::Vector2f);
+        Board(const sf::Vector2f&, bool headless = false);
+        void update(float dt);
+        void draw(sf::RenderTarget&, bool debug);
+        // Copies what draw() would show into a snapshot for another thread
+        void capture(BoardSnapshot&);
         void mouseDown(const sf::Vector2f&);
         void mouseMove(const sf::Vector2f&);
         void mouseUp();
         bool isDragging() const { return drag.active; };
         void loadLevel(const std::string&, bool);
+        void stepLevel(int);
+        // Reloads the current level after its source changed, rebuilding
+        // only what differs and keeping the view where it is.
+        void reviseLevel();
+
+        // Editing mode: mouse and edit keys change the level instead of
+        // playing it.
+        void toggleEditing();
+        bool isEditing() const { return editor.isActive(); }
+        void editPress(const sf::Vector2f& pixel, bool connect);
+        void editMove(const sf::Vector2f& pixel);
+        void editRelease();
+        enum class Edit { Remove, ToggleStart, SetTarget };
+        void edit(Edit);
+        // Editor status while editing, else what became of a requested
+        // solution playback; empty when there's nothing to say.
+        std::string status() const;
+        std::string editedSource() const { return editor.source(); }
+        bool isLoading() const { return !wanted.empty(); }
+        void setCacheBudget(std::size_t bytes) { cache.setBudget(bytes); }
+        // Caps identicon memory, resident plus baking; 0 for no cap. Over
+        // it, cached levels give up their identicons first, then identicons
+        // are baked a resolution tier lower.
+        void setMemoryBudget(std::size_t bytes) { memoryBudget = bytes; memoryDirty = true; }
+        // As of the last update()
+        const MemoryUsage& memoryUsage() const { return memory; }
+        // Input positions are pixels of a window this size
+        void setWindowSize(const sf::Vector2f& size)
+        {
+            camera.setWindowSize(size);
+            pixelScale = size.x / wsize.x;
+        }
+
+        // Replays drive level changes themselves: requests from buttons and
+        // keys are ignored and loadLevelNow() swaps synchronously.
+        void setScripted(bool value) { scripted = value; }
+        void loadLevelNow(const std::string&, bool);
+        void setLevelListener(std::function<void(const Level&)> listener) { onLevelActivated = std::move(listener); }
+        const Puzzle& getPuzzle() const { return level->puzzle; }
+        const Level& getLevel() const { return *level; }
+        const Colorset& getColorset() const { return colorset; }
+        void pan(const sf::Vector2f& pixelDelta) { camera.pan(pixelDelta); }
+        void zoom(const sf::Vector2f& pixel, float factor) { camera.zoomAt(pixel, factor); }
+        void resetView();
+        void toggleHints();
+        // Plays the rest of the solution from where the chips are, at speed
+        // times normal pace, once the hint search has reached this state.
+        void playSolution(float speed);
     
     private:
-        Chip* getChipByUid(int uid);
-        void addPoint(uint32_t, int, int);
-        void addConnection(int, int);
-        void placeChip(uint32_t, int);
-        void setTargetPositions(const std::vector<int>&);
-        void bake();
-        void bakeChipTextures(float cellSize = 48.0f);
-        void bakeHintTextures(float cellSize = 48.0f);
-        void drawChips(sf::RenderTarget&) const;
-        void drawHints(sf::RenderTarget&) const;
-        void drawDraggedChip(sf::RenderTarget&) const;
-        std::vector<int> findPath(int start, int goal) const;
-        void update(float dt);
-        void clear();
-        void loadFromStream(std::istream&);
+        void resolveDrag();
+        void queueSolution();
+        void captureSuggestion(std::vector<int>&);
+        unsigned textureResolution(float zoom) const;
+        void updateTextureResolution();
+        void measureMemory();
+        void enforceMemoryBudget();
+        enum class Revision { None, File, Edit };
+        void reviseLevel(const std::string& source, bool external, Revision);
+        void applyEdit();
+        void receiveLevel();
+        void swapIn(std::shared_ptr<Level>);
+        static void carryChips(const Puzzle& from, Puzzle& to);
+        void prefetchNeighbours();
+        void updatePlaylist(const std::string&, bool);
+        void queryVisibleNodes(const sf::FloatRect&) const;
 
         std::vector<Button> levelButtons;
-        sf::Font uiFont;
         const sf::Vector2f wsize;
-        float chipScale = 1.0f;
-        float hintScale = 1.0f;
+        Camera camera;
         Colorset colorset;
-        std::vector<int> targetPositions;
-        std::vector<PolyLine> bakedConnections;
-        std::vector<Honeycomb> bakedHoneycombs;
-        std::unordered_map<uint32_t, Node> node;
-        std::unordered_map<uint32_t, std::vector<uint32_t>> adjacency;
-        std::vector<Chip> chips;
-        std::unordered_map<int, std::shared_ptr<sf::Texture>> chipTextures;
-        std::unordered_map<int, std::shared_ptr<sf::Texture>> hintTextures;
+        const bool headless;                            // no GL: textures are never baked
+        bool scripted = false;
+        std::function<void(const Level&)> onLevelActivated;
+
+        // The current level keeps rendering and taking input until the
+        // loader's replacement has its textures baked, then the two swap.
+        static constexpr float textureBudget = 4.0f;    // ms of texture baking per frame
+        IdenticonBaker identicons;
+        LevelLoader loader;
+        std::shared_ptr<Level> level;
+        std::shared_ptr<Level> incoming;
+        std::string wanted;                             // key of the level the player asked for
+        Revision revision = Revision::None;             // wanted is a new version of the current level
+
+        // Levels either side of the current one in the playlist are loaded
+        // in idle frames, so stepping to them is a pointer swap.
+        static constexpr float prefetchBudget = 1.0f;   // ms of texture baking per idle frame
+        LevelCache cache{ 64u << 20 };
+        std::vector<std::pair<std::string, bool>> playlist;
+        std::vector<std::string> playlistKeys;
+        int current = -1;
+        std::shared_ptr<Level> prefetching;
+        std::set<std::string> prefetchAttempted;
+
+        // Identicons are baked at about the size they appear on screen, in
+        // power of two tiers, and rebaked when zooming leaves the tier.
+        static constexpr unsigned minResolution = 16;  // pixels across a chip
+        static constexpr unsigned maxResolution = 256;
+        float pixelScale = 1.0f;
+
+        // Measured while anything bakes or after levels change hands
+        std::size_t memoryBudget = 0;
+        unsigned resolutionCap = maxResolution;         // a tier; lowered to stay in budget
+        MemoryUsage memory;
+        bool memoryDirty = true;
+        std::unordered_set<const void*> measured;       // measureMemory() scratch
+
+        mutable std::vector<uint32_t> visible;         // hit testing
+
+        // draw() captures into this and renders it on the calling thread
+        BoardRenderer renderer;
+        BoardSnapshot frame;
+        uint64_t captures = 0;
+
+        // Solved-state search runs only once the player asks for hints
+        HintEngine hints;
+        bool showHints = false;
 
         DragState drag;
+
+        // Moves keep animating after the puzzle has made them
+        static constexpr float moveDuration = 1.0f;     // seconds, a move the player made
+        static constexpr float playbackDuration = 0.6f; // seconds per move at speed 1
+        static constexpr float playbackSpacing = 0.3f;  // between move starts at speed 1
+        AnimationScheduler animations;
+        float playbackSpeed = 0.0f;                     // non-zero while a solution waits to be queued
+        std::size_t playbackStates = 0;                 // hint table size at the last lookup
+        std::string playbackNotice;                     // why playback was dropped
+        uint64_t playbackNoticeHash = 0;                // shown while the board is left as it was
+        std::vector<int> playbackPath;
+
+        LevelEditor editor;
 };
 
 
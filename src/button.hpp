@@ -38,20 +38,11 @@ public:
         }
     }
 
-    void draw(sf::RenderTarget& target)
+    sf::Color color() const
     {
-        sf::RectangleShape rect(size);
-        rect.setPosition(position);
-
-        if (pressed) {
-            rect.setFillColor(clickedColor);
-        } else if (hovered) {
-            rect.setFillColor(hoveredColor);
-        } else {
-            rect.setFillColor(normalColor);
-        }
-
-        target.draw(rect);
+        if (pressed) return clickedColor;
+        if (hovered) return hoveredColor;
+        return normalColor;
     }
 
     bool contains(const sf::Vector2f& point) const
@@ -0,0 +1,80 @@
+#pragma once
+#include <SFML/Graphics.hpp>
+#include <algorithm>
+#include <cmath>
+
+namespace cb {
+
+// Pan/zoom over the board. Input positions are window pixels; the view is
+// laid out in screen units, the window's initial size, which the window
+// stretches to whatever size it has now. World positions are the
+// coordinates nodes are stored in.
+class Camera
+{
+    public:
+        Camera(const sf::Vector2f& screen): screen(screen), window(screen), view(screen * 0.5f, screen) {}
+
+        const sf::View& getView() const { return view; }
+        float getZoom() const { return zoom; }
+        void setWindowSize(const sf::Vector2f& size) { window = size; }
+
+        sf::Vector2f toScreen(const sf::Vector2f& pixel) const
+        {
+            return sf::Vector2f{ pixel.x * screen.x / window.x, pixel.y * screen.y / window.y };
+        }
+
+        sf::Vector2f toWorld(const sf::Vector2f& pixel) const
+        {
+            return view.getCenter() + (toScreen(pixel) - screen * 0.5f) * zoom;
+        }
+
+        sf::FloatRect visibleArea() const
+        {
+            const sf::Vector2f size = view.getSize();
+            return sf::FloatRect{ view.getCenter() - size * 0.5f, size };
+        }
+
+        void pan(const sf::Vector2f& pixelDelta)
+        {
+            view.move(-toScreen(pixelDelta) * zoom);
+        }
+
+        // Zoom keeping the world point under the cursor fixed.
+        void zoomAt(const sf::Vector2f& pixel, float factor)
+        {
+            const sf::Vector2f anchor = toWorld(pixel);
+            setZoom(zoom * factor);
+            view.move(anchor - toWorld(pixel));
+        }
+
+        // Frame the bounds, never magnifying beyond 1:1.
+        void fit(const sf::FloatRect& bounds, float margin = 64.0f)
+        {
+            setZoom(zoomToFit(bounds, margin));
+            view.setCenter(bounds.position + bounds.size * 0.5f);
+        }
+
+        float zoomToFit(const sf::FloatRect& bounds, float margin = 64.0f) const
+        {
+            const float zx = (bounds.size.x + 2.0f * margin) / screen.x;
+            const float zy = (bounds.size.y + 2.0f * margin) / screen.y;
+            return std::clamp(std::max({ 1.0f, zx, zy }), minZoom, maxZoom);
+        }
+
+        static constexpr float minZoom = 0.25f;
+        static constexpr float maxZoom = 256.0f;
+
+    private:
+        void setZoom(float z)
+        {
+            zoom = std::clamp(z, minZoom, maxZoom);
+            view.setSize(screen * zoom);
+        }
+
+        sf::Vector2f screen;
+        sf::Vector2f window;
+        sf::View view;
+        float zoom = 1.0f;      // world units per pixel
+};
+
+}
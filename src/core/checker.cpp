@@ -0,0 +1,139 @@
+#include "checker.hpp"
+#include <algorithm>
+
+namespace cb {
+
+namespace {
+
+constexpr std::size_t quickStates = std::size_t{ 1 } << 18;    // best-first budget, well under a second
+
+}
+
+SolvabilityChecker::SolvabilityChecker(std::size_t maxStates)
+    : maxStates(maxStates), worker(&SolvabilityChecker::run, this)
+{
+}
+
+SolvabilityChecker::~SolvabilityChecker()
+{
+    {
+        std::lock_guard lock(mutex);
+        stopping = true;
+        cancel = true;
+        pending.reset();
+    }
+    wake.notify_one();
+    worker.join();
+}
+
+void SolvabilityChecker::submit(const Puzzle& puzzle)
+{
+    const uint64_t layout = layoutHash(puzzle);
+    {
+        std::lock_guard lock(mutex);
+        if (current.layout == layout && current.state != Status::Idle) return;
+
+        cancel = true;
+        pending.reset();
+        if (auto it = known.find(layout); it != known.end())
+        {
+            current = Status{ Status::Done, it->second.result, it->second.moves, it->second.bound, layout };
+            return;
+        }
+
+        const int bound = latest ? replay(puzzle, latest->solution) : -1;
+        current = Status{ Status::Checking, SolveResult::Unsolvable, -1, bound, layout };
+        pending = puzzle;
+    }
+    wake.notify_one();
+}
+
+SolvabilityChecker::Status SolvabilityChecker::status() const
+{
+    std::lock_guard lock(mutex);
+    return current;
+}
+
+uint64_t SolvabilityChecker::layoutHash(const Puzzle& puzzle)
+{
+    uint64_t h = 0xcbf29ce484222325ull;
+    auto mix = [&](uint64_t value) {
+        h ^= value;
+        h *= 0x100000001b3ull;
+        h ^= h >> 29;
+    };
+
+    mix(puzzle.nodeCount());
+    std::vector<uint64_t> pairs;
+    pairs.reserve(puzzle.getConnections().size());
+    for (const auto& [from, to] : puzzle.getConnections())
+        pairs.push_back(uint64_t{ std::min(from, to) } << 32 | std::max(from, to));
+    std::sort(pairs.begin(), pairs.end());
+    pairs.erase(std::unique(pairs.begin(), pairs.end()), pairs.end());
+    mix(pairs.size());
+    for (uint64_t pair : pairs) mix(pair);
+
+    mix(puzzle.getInitialPositions().size());
+    for (int position : puzzle.getInitialPositions()) mix(static_cast<uint64_t>(position));
+    mix(puzzle.getTargets().size());
+    for (int target : puzzle.getTargets()) mix(static_cast<uint64_t>(target));
+    return h;
+}
+
+// Length of the solution if it is still legal and still solves the puzzle
+// from its starting layout, else -1.
+int SolvabilityChecker::replay(Puzzle puzzle, const std::vector<Move>& solution)
+{
+    puzzle.reset();
+    for (const Move& move : solution)
+    {
+        if (!puzzle.move(move.chip, move.to)) return -1;
+    }
+    return puzzle.isSolved() ? static_cast<int>(solution.size()) : -1;
+}
+
+void SolvabilityChecker::run()
+{
+    std::unique_lock lock(mutex);
+    while (true)
+    {
+        wake.wait(lock, [&]() { return stopping || pending.has_value(); });
+        if (stopping) return;
+
+        Puzzle job = std::move(*pending);
+        pending.reset();
+        cancel = false;
+        const uint64_t layout = current.layout;
+
+        lock.unlock();
+        job.reset();
+        SolveResult quick = solveQuickly(job, SolveLimits{ quickStates, &cancel });
+        lock.lock();
+
+        if (quick.status == SolveResult::Cancelled) continue;
+        if (quick.status == SolveResult::Solved && current.layout == layout && (current.bound < 0 || quick.moves < current.bound))
+            current.bound = quick.moves;
+
+        SolveResult result = quick;                     // every reachable state seen: unsolvable
+        if (quick.status != SolveResult::Unsolvable)
+        {
+            lock.unlock();
+            result = solve(job, SolveLimits{ maxStates, &cancel });
+            lock.lock();
+        }
+
+        if (result.status == SolveResult::Cancelled) continue;
+        Known entry{ result.status, result.moves, -1, std::move(result.solution) };
+        if (result.status == SolveResult::LimitReached && quick.status == SolveResult::Solved)
+        {
+            entry.bound = quick.moves;
+            entry.solution = std::move(quick.solution);
+        }
+        Known& stored = known[layout] = std::move(entry);
+        if (!stored.solution.empty()) latest = &stored;
+        if (current.layout == layout)
+            current = Status{ Status::Done, stored.result, stored.moves, stored.bound, layout };
+    }
+}
+
+}
@@ -0,0 +1,76 @@
+#pragma once
+#include <atomic>
+#include <condition_variable>
+#include <cstdint>
+#include <mutex>
+#include <optional>
+#include <thread>
+#include <unordered_map>
+#include <vector>
+#include "puzzle.hpp"
+#include "solver.hpp"
+
+namespace cb {
+
+// Answers "is this layout solvable, and in how many moves" for a level
+// being edited, on a worker thread so the editor never waits. Only the
+// latest layout matters: submitting cancels the search in progress.
+//
+// Work is reused where an edit allows. Results are kept per layout hash,
+// which ignores node positions, so dragging nodes around or undoing back to
+// an earlier layout answers at once. A solution that still replays on the
+// new layout is shown straight away as an upper bound on the move count
+// while the search for the optimum runs. A quick best-first search goes
+// first, so a bound is known within moments even where the optimum is out
+// of reach; it is what a layout with too many states is left with.
+class SolvabilityChecker
+{
+    public:
+        struct Status
+        {
+            enum State { Idle, Checking, Done };
+
+            State state = Idle;
+            SolveResult::Status result = SolveResult::Unsolvable;
+            int moves = -1;                 // optimal when Done and Solved
+            int bound = -1;                 // while Checking or at LimitReached: a known solution's length, or -1
+            uint64_t layout = 0;            // hash of the layout this describes
+        };
+
+        explicit SolvabilityChecker(std::size_t maxStates = std::size_t{ 1 } << 22);
+        ~SolvabilityChecker();
+        SolvabilityChecker(const SolvabilityChecker&) = delete;
+        SolvabilityChecker& operator=(const SolvabilityChecker&) = delete;
+
+        void submit(const Puzzle&);
+        Status status() const;
+
+        // Node count, connections, starts and targets; not positions.
+        static uint64_t layoutHash(const Puzzle&);
+
+    private:
+        struct Known
+        {
+            SolveResult::Status result;
+            int moves;
+            int bound;                      // when the optimum is out of reach
+            std::vector<Move> solution;     // optimal, else the bound's
+        };
+
+        void run();
+        static int replay(Puzzle, const std::vector<Move>&);
+
+        const std::size_t maxStates;
+
+        mutable std::mutex mutex;
+        std::condition_variable wake;
+        std::optional<Puzzle> pending;
+        Status current;
+        std::unordered_map<uint64_t, Known> known;      // finished searches
+        const Known* latest = nullptr;                  // most recent entry of known with a solution
+        std::atomic<bool> cancel = false;
+        bool stopping = false;
+        std::thread worker;
+};
+
+}
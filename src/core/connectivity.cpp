@@ -0,0 +1,258 @@
+#include "connectivity.hpp"
+#include <algorithm>
+#include "puzzle.hpp"
+
+namespace cb {
+
+void Connectivity::build(const Puzzle& puzzle)
+{
+    const std::size_t n = puzzle.nodeCount();
+    label.assign(n, -1);
+    next.assign(n, 0);
+    previous.assign(n, 0);
+    head.assign(n, 0);
+    sizes.assign(n, 0);
+    freeLabels.clear();
+    for (std::size_t i = n; i > 0; --i) freeLabels.push_back(static_cast<int>(i - 1));
+    seenStamp.assign(n, 0);
+    seenBy.assign(n, 0);
+    seenEpoch = 0;
+
+    std::vector<uint32_t>& queue = freeNeighbours;
+    queue.reserve(n);
+    for (uint32_t uid = 1; uid <= n; ++uid)
+    {
+        if (label[uid - 1] != -1 || puzzle.chipAt(uid) != -1) continue;
+
+        const int component = newLabel();
+        assign(uid, component);
+        queue.assign(1, uid);
+        for (std::size_t at = 0; at < queue.size(); ++at)
+        {
+            for (uint32_t neighbor : puzzle.neighbours(queue[at]))
+            {
+                if (label[neighbor - 1] != -1 || puzzle.chipAt(neighbor) != -1) continue;
+                assign(neighbor, component);
+                queue.push_back(neighbor);
+            }
+        }
+    }
+}
+
+void Connectivity::vacate(const Puzzle& puzzle, int node)
+{
+    if (label[node - 1] != -1) return;
+
+    const std::vector<int>& around = borderingComponents(puzzle, node);
+    if (around.empty())
+    {
+        assign(node, newLabel());
+        return;
+    }
+
+    const int keep = *std::max_element(around.begin(), around.end(), [&](int a, int b) { return sizes[a] < sizes[b]; });
+    for (int other : around)
+    {
+        if (other == keep) continue;
+
+        // Relabel the smaller list, then splice it in front of keep's
+        uint32_t last = 0;
+        for (uint32_t member = head[other]; member != 0; member = next[member - 1])
+        {
+            label[member - 1] = keep;
+            last = member;
+        }
+        next[last - 1] = head[keep];
+        if (head[keep] != 0) previous[head[keep] - 1] = last;
+        head[keep] = head[other];
+        sizes[keep] += sizes[other];
+        head[other] = 0;
+        sizes[other] = 0;
+        release(other);
+    }
+    assign(node, keep);
+}
+
+void Connectivity::occupy(const Puzzle& puzzle, int node)
+{
+    const int component = label[node - 1];
+    if (component == -1) return;
+    unassign(node);
+    if (sizes[component] == 0)
+    {
+        release(component);
+        return;
+    }
+
+    if (++seenEpoch == 0)
+    {
+        std::fill(seenStamp.begin(), seenStamp.end(), 0);
+        seenEpoch = 1;
+    }
+
+    freeNeighbours.clear();
+    for (uint32_t neighbor : puzzle.neighbours(node))
+    {
+        if (label[neighbor - 1] != component || seenStamp[neighbor - 1] == seenEpoch) continue;
+        seenStamp[neighbor - 1] = seenEpoch;
+        seenBy[neighbor - 1] = static_cast<uint16_t>(freeNeighbours.size());
+        freeNeighbours.push_back(neighbor);
+    }
+    if (freeNeighbours.size() <= 1) return;     // removing a leaf never splits
+
+    const std::size_t count = freeNeighbours.size();
+    if (searches.size() < count) searches.resize(count);   // shrinking would free their queues
+    for (std::size_t i = 0; i < count; ++i)
+    {
+        searches[i].queue.assign(1, freeNeighbours[i]);
+        searches[i].head = 0;
+        searches[i].group = static_cast<int>(i);
+    }
+
+    auto root = [&](int s) {
+        while (searches[s].group != s) s = searches[s].group = searches[searches[s].group].group;
+        return s;
+    };
+    auto exhausted = [&](const Search& s) { return s.head == s.queue.size(); };
+
+    // Searches that meet belong to the same piece. Stop once at most one
+    // piece is still growing: every other piece is then fully enumerated.
+    int kept = -1;
+    while (true)
+    {
+        int pieces = 0;
+        int growing = 0;
+        int lastGrowing = -1;
+        for (std::size_t s = 0; s < count; ++s)
+        {
+            if (root(static_cast<int>(s)) != static_cast<int>(s)) continue;
+            ++pieces;
+            for (std::size_t t = 0; t < count; ++t)
+            {
+                if (root(static_cast<int>(t)) == static_cast<int>(s) && !exhausted(searches[t]))
+                {
+                    ++growing;
+                    lastGrowing = static_cast<int>(s);
+                    break;
+                }
+            }
+        }
+        if (pieces == 1) return;
+        if (growing <= 1)
+        {
+            kept = lastGrowing;
+            break;
+        }
+
+        for (std::size_t s = 0; s < count; ++s)
+        {
+            Search& search = searches[s];
+            if (exhausted(search)) continue;
+            const uint32_t current = search.queue[search.head++];
+            for (uint32_t neighbor : puzzle.neighbours(current))
+            {
+                if (label[neighbor - 1] != component) continue;
+                if (seenStamp[neighbor - 1] != seenEpoch)
+                {
+                    seenStamp[neighbor - 1] = seenEpoch;
+                    seenBy[neighbor - 1] = static_cast<uint16_t>(s);
+                    search.queue.push_back(neighbor);
+                }
+                else if (const int other = root(seenBy[neighbor - 1]); other != root(static_cast<int>(s)))
+                {
+                    searches[other].group = root(static_cast<int>(s));
+                }
+            }
+        }
+    }
+
+    // Everything closed off: the biggest piece keeps the old label
+    if (kept == -1)
+    {
+        std::vector<std::size_t>& sizes = pieceSizes;
+        sizes.assign(count, 0);
+        for (std::size_t s = 0; s < count; ++s) sizes[root(static_cast<int>(s))] += searches[s].queue.size();
+        kept = static_cast<int>(std::max_element(sizes.begin(), sizes.end()) - sizes.begin());
+    }
+
+    for (std::size_t s = 0; s < count; ++s)
+    {
+        const int piece = root(static_cast<int>(s));
+        if (piece == kept || piece != static_cast<int>(s)) continue;
+
+        const int split = newLabel();
+        for (std::size_t t = 0; t < count; ++t)
+        {
+            if (root(static_cast<int>(t)) != piece) continue;
+            for (uint32_t member : searches[t].queue)
+            {
+                unassign(member);
+                assign(member, split);
+            }
+        }
+    }
+}
+
+bool Connectivity::canReach(const Puzzle& puzzle, int from, int to) const
+{
+    if (from == to || label[to - 1] == -1) return false;
+    for (uint32_t neighbor : puzzle.neighbours(from))
+    {
+        if (label[neighbor - 1] == label[to - 1]) return true;
+    }
+    return false;
+}
+
+void Connectivity::destinations(const Puzzle& puzzle, int from, std::vector<int>& out) const
+{
+    for (int component : borderingComponents(puzzle, from))
+        forEachMember(component, [&](uint32_t node) { out.push_back(static_cast<int>(node)); });
+}
+
+const std::vector<int>& Connectivity::borderingComponents(const Puzzle& puzzle, int node) const
+{
+    bordering.clear();
+    for (uint32_t neighbor : puzzle.neighbours(node))
+    {
+        const int component = label[neighbor - 1];
+        if (component != -1 && std::find(bordering.begin(), bordering.end(), component) == bordering.end())
+            bordering.push_back(component);
+    }
+    return bordering;
+}
+
+int Connectivity::newLabel()
+{
+    const int reused = freeLabels.back();
+    freeLabels.pop_back();
+    return reused;
+}
+
+void Connectivity::release(int component)
+{
+    freeLabels.push_back(component);
+}
+
+void Connectivity::assign(uint32_t node, int component)
+{
+    label[node - 1] = component;
+    previous[node - 1] = 0;
+    next[node - 1] = head[component];
+    if (head[component] != 0) previous[head[component] - 1] = node;
+    head[component] = node;
+    ++sizes[component];
+}
+
+void Connectivity::unassign(uint32_t node)
+{
+    const int component = label[node - 1];
+    const uint32_t before = previous[node - 1];
+    const uint32_t after = next[node - 1];
+    if (before != 0) next[before - 1] = after;
+    else head[component] = after;
+    if (after != 0) previous[after - 1] = before;
+    --sizes[component];
+    label[node - 1] = -1;
+}
+
+}
@@ -0,0 +1,70 @@
+#pragma once
+#include <cstdint>
+#include <cstddef>
+#include <vector>
+
+namespace cb {
+
+class Puzzle;
+
+// Connected components of the free (unoccupied) nodes, kept up to date as
+// chips come and go. A node becoming free merges the components around it,
+// relabelling the smaller ones into the largest; a node becoming occupied
+// may split its component, which is settled by searching outwards from its
+// free neighbours in lockstep and relabelling only the pieces that close
+// off first. Labels are found in O(1) and each component lists its members.
+class Connectivity
+{
+    public:
+        void build(const Puzzle&);
+        void vacate(const Puzzle&, int node);
+        void occupy(const Puzzle&, int node);
+
+        int component(int node) const { return label[node - 1]; }     // -1 when occupied
+        std::size_t size(int component) const { return sizes[component]; }
+
+        template<class F>
+        void forEachMember(int component, F&& f) const
+        {
+            for (uint32_t node = head[component]; node != 0; node = next[node - 1]) f(node);
+        }
+
+        // A chip on from can stop on to: to is free and borders from.
+        bool canReach(const Puzzle&, int from, int to) const;
+        // Every node a chip on from can stop on, appended to out.
+        void destinations(const Puzzle&, int from, std::vector<int>& out) const;
+
+    private:
+        int newLabel();
+        void release(int);
+        void assign(uint32_t node, int component);
+        void unassign(uint32_t node);
+        const std::vector<int>& borderingComponents(const Puzzle&, int node) const;
+
+        // Members are intrusive lists threaded through per-node arrays, and
+        // there are never more labels than nodes, so everything is sized
+        // once by build() and updates don't allocate.
+        std::vector<int32_t> label;                 // per node
+        std::vector<uint32_t> next;                 // per node, uid or 0
+        std::vector<uint32_t> previous;
+        std::vector<uint32_t> head;                 // per label, uid or 0
+        std::vector<uint32_t> sizes;
+        std::vector<int> freeLabels;
+        mutable std::vector<int> bordering;
+        std::vector<uint32_t> freeNeighbours;
+
+        // Lockstep split search, one queue per free neighbour
+        struct Search
+        {
+            std::vector<uint32_t> queue;
+            std::size_t head = 0;
+            int group = 0;
+        };
+        std::vector<Search> searches;
+        std::vector<std::size_t> pieceSizes;
+        std::vector<uint32_t> seenStamp;
+        std::vector<uint16_t> seenBy;
+        uint32_t seenEpoch = 0;
+};
+
+}
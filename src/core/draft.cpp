@@ -0,0 +1,121 @@
+#include "draft.hpp"
+#include <algorithm>
+#include <cmath>
+#include <sstream>
+
+namespace cb {
+
+LevelDraft LevelDraft::from(const Puzzle& puzzle, float dx, float dy)
+{
+    LevelDraft draft;
+    draft.nodes.reserve(puzzle.nodeCount());
+    for (const Node& node : puzzle.getNodes())
+        draft.nodes.push_back(Point{ static_cast<int>(std::lround(node.x - dx)), static_cast<int>(std::lround(node.y - dy)) });
+    for (const auto& [from, to] : puzzle.getConnections())
+        draft.connections.emplace_back(static_cast<int>(from), static_cast<int>(to));
+    draft.starts = puzzle.getInitialPositions();
+    draft.targets = puzzle.getTargets();
+    return draft;
+}
+
+int LevelDraft::addNode(int x, int y)
+{
+    nodes.push_back(Point{ x, y });
+    return static_cast<int>(nodes.size());
+}
+
+void LevelDraft::moveNode(int uid, int x, int y)
+{
+    nodes[uid - 1] = Point{ x, y };
+}
+
+// Drops everything attached to the node, then closes the gap in the uids.
+std::size_t LevelDraft::removeNode(int uid)
+{
+    auto renumber = [uid](int& other) { if (other > uid) --other; };
+
+    std::erase_if(connections, [uid](const auto& connection) { return connection.first == uid || connection.second == uid; });
+    for (auto& [from, to] : connections)
+    {
+        renumber(from);
+        renumber(to);
+    }
+
+    std::size_t dropped = 0;
+    for (std::size_t i = starts.size(); i-- > 0;)
+    {
+        if (starts[i] != uid && (i >= targets.size() || targets[i] != uid)) continue;
+        removeChip(i);
+        ++dropped;
+    }
+    for (int& start : starts) renumber(start);
+    for (int& target : targets) renumber(target);
+
+    nodes.erase(nodes.begin() + (uid - 1));
+    return dropped;
+}
+
+void LevelDraft::toggleConnection(int from, int to)
+{
+    if (from == to) return;
+    auto same = [&](const auto& connection) {
+        return (connection.first == from && connection.second == to) || (connection.first == to && connection.second == from);
+    };
+    if (std::erase_if(connections, same) == 0) connections.emplace_back(from, to);
+}
+
+int LevelDraft::toggleStart(int uid)
+{
+    const int chip = chipStartingAt(uid);
+    if (chip != -1)
+    {
+        removeChip(static_cast<std::size_t>(chip));
+        return -1;
+    }
+    starts.push_back(uid);
+    if (targets.size() + 1 == starts.size()) targets.push_back(uid);
+    return static_cast<int>(starts.size() - 1);
+}
+
+// Targets pair with chips by index, so chips before this one that had none
+// get their start as target.
+void LevelDraft::setTarget(std::size_t chip, int uid)
+{
+    if (chip >= starts.size()) return;
+    while (targets.size() <= chip) targets.push_back(starts[targets.size()]);
+    targets[chip] = uid;
+}
+
+void LevelDraft::removeChip(std::size_t chip)
+{
+    starts.erase(starts.begin() + static_cast<std::ptrdiff_t>(chip));
+    if (chip < targets.size()) targets.erase(targets.begin() + static_cast<std::ptrdiff_t>(chip));
+}
+
+int LevelDraft::chipStartingAt(int uid) const
+{
+    auto found = std::find(starts.begin(), starts.end(), uid);
+    return found == starts.end() ? -1 : static_cast<int>(found - starts.begin());
+}
+
+// The level format, as Puzzle::parse reads it. Blank lines are skipped
+// there, so an empty list is written as a lone comma.
+std::string LevelDraft::serialize() const
+{
+    std::ostringstream out;
+    auto list = [&](const std::vector<int>& values) {
+        if (values.empty()) out << ',';
+        for (std::size_t i = 0; i < values.size(); ++i) out << (i ? "," : "") << values[i];
+        out << '\n';
+    };
+
+    out << starts.size() << '\n' << nodes.size() << '\n';
+    for (const Point& node : nodes) out << node.x << ',' << node.y << '\n';
+    list(starts);
+    list(targets);
+    out << connections.size() << '\n';
+    for (const auto& [from, to] : connections) out << from << ',' << to << '\n';
+    return out.str();
+}
+
+}
@@ -0,0 +1,52 @@
+#pragma once
+#include <cstddef>
+#include <string>
+#include <utility>
+#include <vector>
+#include "puzzle.hpp"
+
+namespace cb {
+
+// A level as the editor changes it: the lists of the level format, kept in
+// level file coordinates and written back out as level text. Uids are
+// 1-based as in the format; removing a node renumbers the ones after it.
+class LevelDraft
+{
+    public:
+        struct Point
+        {
+            int x;
+            int y;
+        };
+
+        // The puzzle's starting layout, shifted back from world to file
+        // coordinates by (dx, dy).
+        static LevelDraft from(const Puzzle&, float dx, float dy);
+
+        int addNode(int x, int y);
+        void moveNode(int uid, int x, int y);
+        std::size_t removeNode(int uid);                // returns how many chips went with it
+        void toggleConnection(int from, int to);
+        // Adds a chip starting at uid, or removes the chip that starts
+        // there. Returns the new chip's index, or -1. Its target is its
+        // start until set, unless earlier chips have no targets either.
+        int toggleStart(int uid);
+        void setTarget(std::size_t chip, int uid);
+
+        std::size_t nodeCount() const { return nodes.size(); }
+        const Point& node(int uid) const { return nodes[uid - 1]; }
+        std::size_t chipCount() const { return starts.size(); }
+        int chipStartingAt(int uid) const;
+
+        std::string serialize() const;
+
+    private:
+        void removeChip(std::size_t);
+
+        std::vector<Point> nodes;
+        std::vector<std::pair<int, int>> connections;
+        std::vector<int> starts;
+        std::vector<int> targets;                       // per chip; the format allows fewer
+};
+
+}
@@ -0,0 +1,209 @@
+#include "hints.hpp"
+#include <algorithm>
+#include <limits>
+#include <mutex>
+
+namespace cb {
+
+using namespace search;
+
+namespace {
+
+constexpr std::size_t sliceStates = 1024;   // expanded between table updates
+constexpr std::size_t planStates = 1 << 16; // forward search bound, a few frames at worst
+constexpr int planWeight = 8;               // greed of the forward search: fewer states, longer routes
+
+}
+
+HintEngine::HintEngine(std::size_t maxStates)
+    : maxStates(maxStates)
+{
+}
+
+HintEngine::~HintEngine()
+{
+    stop();
+}
+
+void HintEngine::start(const Puzzle& puzzle)
+{
+    stop();
+
+    const std::size_t chips = puzzle.getChips().size();
+    if (chips == 0 || chips != puzzle.getTargets().size()) return;
+    if (puzzle.nodeCount() > std::numeric_limits<Position>::max()) return;
+
+    graph = puzzle;
+    width = chips;
+    stopping = false;
+    complete = false;
+    finished = false;
+    worker = std::thread(&HintEngine::run, this);
+}
+
+void HintEngine::stop()
+{
+    stopping = true;
+    if (worker.joinable()) worker.join();
+
+    std::unique_lock lock(mutex);
+    table = StateSet{ 1 };
+    layerStart.clear();
+    cached.reset();
+    routeStates.clear();
+    routeMoves.clear();
+}
+
+std::size_t HintEngine::states() const
+{
+    std::shared_lock lock(mutex);
+    return table.size();
+}
+
+void HintEngine::run()
+{
+    std::vector<Position> goal(width);
+    for (std::size_t i = 0; i < width; ++i) goal[i] = static_cast<Position>(graph.getTargets()[i]);
+    {
+        std::unique_lock lock(mutex);
+        table = StateSet{ width };
+        table.insert(goal.data(), Step{ noParent, 0, 0 });
+        layerStart.assign(1, 0);
+    }
+
+    Scratch local;
+    local.prepare(graph.nodeCount());
+    std::vector<Position> batch;
+
+    // Only this thread inserts, so it reads the table without locking.
+    std::size_t begin = 0;
+    while (begin < table.size())
+    {
+        const std::size_t end = table.size();
+        {
+            std::unique_lock lock(mutex);
+            layerStart.push_back(end);
+        }
+
+        for (std::size_t slice = begin; slice < end; slice += sliceStates)
+        {
+            if (stopping) return;
+
+            batch.clear();
+            const std::size_t sliceEnd = std::min(end, slice + sliceStates);
+            for (std::size_t i = slice; i < sliceEnd; ++i)
+            {
+                forEachMove(graph, table.at(i), width, local, [&](std::size_t, uint32_t, const Position* next) {
+                    if (!table.contains(next)) batch.insert(batch.end(), next, next + width);
+                });
+            }
+
+            std::unique_lock lock(mutex);
+            for (std::size_t i = 0; i < batch.size(); i += width)
+                table.insert(batch.data() + i, Step{ noParent, 0, 0 });
+            if (table.size() >= maxStates)
+            {
+                finished = true;
+                return;
+            }
+        }
+        begin = end;
+    }
+    complete = true;
+    finished = true;
+}
+
+int HintEngine::depthOf(std::size_t index) const
+{
+    return static_cast<int>(std::upper_bound(layerStart.begin(), layerStart.end(), index) - layerStart.begin()) - 1;
+}
+
+std::size_t HintEngine::lookup(const Puzzle& puzzle) const
+{
+    const auto& chips = puzzle.getChips();
+    current.clear();
+    if (chips.size() != width || layerStart.empty()) return npos;
+
+    current.resize(width);
+    for (std::size_t i = 0; i < width; ++i) current[i] = static_cast<Position>(chips[i].position);
+    return table.find(current.data());
+}
+
+int HintEngine::distance(const Puzzle& puzzle) const
+{
+    std::shared_lock lock(mutex);
+    const std::size_t index = lookup(puzzle);
+    return index == npos ? -1 : depthOf(index);
+}
+
+std::optional<Move> HintEngine::hint(const Puzzle& puzzle) const
+{
+    const uint64_t hash = puzzle.hash();
+    if (cached && hash == cachedHash) return cached;
+
+    std::shared_lock lock(mutex);
+    const std::size_t index = lookup(puzzle);
+    if (index == npos)
+    {
+        if (current.empty()) return std::nullopt;
+        cached = follow(puzzle);
+        cachedHash = hash;
+        return cached;
+    }
+
+    const int depth = depthOf(index);
+    if (depth == 0) return std::nullopt;
+
+    // Layer depth - 1 was complete before any state at depth was inserted,
+    // so one of the neighbours is always found.
+    std::optional<Move> best;
+    scratch.prepare(graph.nodeCount());
+    forEachMove(graph, current.data(), width, scratch, [&](std::size_t chip, uint32_t to, const Position* next) {
+        if (best) return;
+        const std::size_t found = table.find(next);
+        if (found != npos && depthOf(found) == depth - 1)
+            best = Move{ static_cast<int>(puzzle.getChips()[chip].uid), static_cast<int>(to) };
+    });
+
+    cached = best;
+    cachedHash = hash;
+    return best;
+}
+
+// Next move of the forward route, planned again when the board has left
+// it or reached the end of a route that stopped short of the table.
+std::optional<Move> HintEngine::follow(const Puzzle& puzzle) const
+{
+    for (std::size_t i = 0; i * width < routeStates.size(); ++i)
+    {
+        if (!std::equal(current.begin(), current.end(), routeStates.begin() + i * width)) continue;
+        if (i < routeMoves.size()) return routeMoves[i];
+        if (routeMoves.empty()) return std::nullopt;   // planned from here and went nowhere
+        break;
+    }
+
+    plan(puzzle);
+    if (routeMoves.empty()) return std::nullopt;
+    return routeMoves.front();
+}
+
+// Bounded best-first search from the current state, ending at the goal or
+// at any state the table holds, whose distance is exact from there on.
+// Call with the lock held.
+void HintEngine::plan(const Puzzle& puzzle) const
+{
+    const BestFirst found = bestFirst(graph, current.data(), width, scratch, planStates, planWeight, nullptr,
+                                      [&](const Position* state) { return table.contains(state); });
+
+    std::vector<Position> state = current;
+    routeStates = current;
+    routeMoves.clear();
+    for (const Step& step : found.steps)
+    {
+        state[step.chip] = step.to;
+        routeStates.insert(routeStates.end(), state.begin(), state.end());
+        routeMoves.push_back(Move{ static_cast<int>(puzzle.getChips()[step.chip].uid), static_cast<int>(step.to) });
+    }
+}
+
+}
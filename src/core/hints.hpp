@@ -0,0 +1,70 @@
+#pragma once
+#include <atomic>
+#include <cstddef>
+#include <cstdint>
+#include <optional>
+#include <shared_mutex>
+#include <thread>
+#include <vector>
+#include "puzzle.hpp"
+#include "solver.hpp"
+#include "state_space.hpp"
+
+namespace cb {
+
+// "Next best move" for whatever state the player is in. A worker searches
+// backwards from the solved state once per level, layer by layer, and keeps
+// every state it reaches with its distance to the goal. That table does not
+// depend on where the chips are, so moves never invalidate it: a hint is a
+// table lookup of the current state's neighbours, answered within a frame
+// as soon as the search has grown out to the player. Until then, or when
+// the table is capped short of the player, a bounded best-first search runs
+// forward from the board until it meets the table or the goal, and its
+// route is followed instead.
+class HintEngine
+{
+    public:
+        explicit HintEngine(std::size_t maxStates = std::size_t{ 1 } << 23);
+        ~HintEngine();
+        HintEngine(const HintEngine&) = delete;
+        HintEngine& operator=(const HintEngine&) = delete;
+
+        void start(const Puzzle&);
+        void stop();
+        bool isStarted() const { return worker.joinable(); }
+
+        std::optional<Move> hint(const Puzzle&) const;
+        int distance(const Puzzle&) const;          // moves to solve, -1 until known
+        std::size_t states() const;
+        bool isComplete() const { return complete.load(); }
+        bool isFinished() const { return finished.load(); }    // complete or capped
+
+    private:
+        void run();
+        int depthOf(std::size_t index) const;
+        std::size_t lookup(const Puzzle&) const;    // call with the lock held
+        std::optional<Move> follow(const Puzzle&) const;
+        void plan(const Puzzle&) const;
+
+        const std::size_t maxStates;
+        Puzzle graph;                               // chips placed on the goal
+        std::size_t width = 0;
+
+        mutable std::shared_mutex mutex;            // exclusive only while inserting
+        search::StateSet table{ 1 };
+        std::vector<std::size_t> layerStart;        // first table index at each distance
+
+        mutable search::Scratch scratch;            // caller's thread only
+        mutable std::vector<search::Position> current;
+        mutable uint64_t cachedHash = 0;
+        mutable std::optional<Move> cached;
+        mutable std::vector<search::Position> routeStates;  // one state before each move, then the last
+        mutable std::vector<Move> routeMoves;
+
+        std::atomic<bool> stopping = false;
+        std::atomic<bool> complete = false;
+        std::atomic<bool> finished = false;
+        std::thread worker;
+};
+
+}
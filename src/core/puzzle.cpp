@@ -0,0 +1,412 @@
+#include "puzzle.hpp"
+#include <algorithm>
+#include <bit>
+#include <cmath>
+#include <functional>
+#include <sstream>
+#include <stdexcept>
+#include <string>
+
+namespace cb {
+
+Puzzle Puzzle::parse(std::istream& file)
+{
+    Puzzle puzzle;
+    std::string line;
+
+    auto nextLine = [&]() -> bool {
+        while (std::getline(file, line)) {
+            if (!line.empty()) return true;
+        }
+        return false;
+    };
+
+    auto pair = [&](int& a, int& b) -> bool {
+        auto commaPos = line.find(',');
+        if (commaPos == std::string::npos) return false;
+        a = std::stoi(line.substr(0, commaPos));
+        b = std::stoi(line.substr(commaPos + 1));
+        return true;
+    };
+
+    auto list = [&]() {
+        std::vector<int> values;
+        std::istringstream stream(line);
+        std::string token;
+        while (std::getline(stream, token, ','))
+        {
+            if (token.empty()) continue;
+            values.push_back(std::stoi(token));
+        }
+        return values;
+    };
+
+    int chipCount = 0;
+    int pointCount = 0;
+
+    if (nextLine()) chipCount = std::stoi(line);
+    if (nextLine()) pointCount = std::stoi(line);
+    puzzle.nodes.reserve(std::max(pointCount, 0));
+    puzzle.chips.reserve(std::max(chipCount, 0));
+
+    for (int i = 0; i < pointCount; ++i)
+    {
+        if (!nextLine()) break;
+        // Uids are line positions, so a point can't just be skipped
+        int x, y;
+        if (!pair(x, y)) throw std::invalid_argument("point " + std::to_string(i + 1) + " is not x,y: " + line);
+        puzzle.addNode(static_cast<float>(x), static_cast<float>(y));
+    }
+
+    if (nextLine())
+    {
+        for (int position : list()) puzzle.placeChip(position);
+    }
+
+    if (nextLine()) puzzle.setTargets(list());
+
+    int connectionCount = 0;
+    if (nextLine()) connectionCount = std::stoi(line);
+
+    for (int i = 0; i < connectionCount; ++i)
+    {
+        if (!nextLine()) break;
+        int from, to;
+        if (pair(from, to)) puzzle.addConnection(from, to);
+    }
+
+    puzzle.finalize();
+    return puzzle;
+}
+
+uint32_t Puzzle::addNode(float x, float y)
+{
+    const uint32_t uid = static_cast<uint32_t>(nodes.size() + 1);
+    nodes.push_back(Node{ uid, x, y, Node::Intersection });
+    return uid;
+}
+
+void Puzzle::addConnection(int from, int to)
+{
+    if (!valid(from) || !valid(to))
+        throw std::out_of_range("connection " + std::to_string(from) + "," + std::to_string(to) + " references a missing node");
+    connections.emplace_back(from, to);
+}
+
+uint32_t Puzzle::placeChip(int position)
+{
+    if (!valid(position))
+        throw std::out_of_range("chip placed on missing node " + std::to_string(position));
+    const uint32_t uid = static_cast<uint32_t>(chips.size() + 1);
+    chips.push_back(Chip{ uid, position });
+    initialPositions.push_back(position);
+    return uid;
+}
+
+void Puzzle::setTargets(const std::vector<int>& positions)
+{
+    for (int position : positions)
+    {
+        if (!valid(position))
+            throw std::out_of_range("target on missing node " + std::to_string(position));
+    }
+    targets = positions;
+}
+
+// Builds the lookup tables; call after the last add*/place*/set* call.
+void Puzzle::finalize()
+{
+    const std::size_t n = nodes.size();
+
+    adjacencyStart.assign(n + 1, 0);
+    for (const auto& [from, to] : connections)
+    {
+        ++adjacencyStart[from];
+        ++adjacencyStart[to];
+    }
+    for (std::size_t i = 1; i <= n; ++i) adjacencyStart[i] += adjacencyStart[i - 1];
+
+    adjacency.resize(adjacencyStart[n]);
+    std::vector<uint32_t> fill(adjacencyStart.begin(), adjacencyStart.end() - 1);
+    for (const auto& [from, to] : connections)
+    {
+        adjacency[fill[from - 1]++] = to;
+        adjacency[fill[to - 1]++] = from;   // bidirectional
+    }
+
+    adjacencyLength.resize(adjacency.size());
+    for (std::size_t i = 0; i < n; ++i)
+    {
+        for (uint32_t k = adjacencyStart[i]; k < adjacencyStart[i + 1]; ++k)
+        {
+            const Node& other = nodes[adjacency[k] - 1];
+            adjacencyLength[k] = std::hypot(other.x - nodes[i].x, other.y - nodes[i].y);
+        }
+    }
+
+    for (Node& pt : nodes) pt.type = Node::Intersection;
+    for (int target : targets) nodes[target - 1].type = Node::Base;
+
+    occupant.assign(n, -1);
+    for (std::size_t i = 0; i < chips.size(); ++i) occupant[chips[i].position - 1] = static_cast<int32_t>(i);
+
+    connectivity.build(*this);
+
+    visitStamp.assign(n, 0);
+    closedStamp.assign(n, 0);
+    cameFrom.assign(n, 0);
+    distance.assign(n, 0.0f);
+    queue.reserve(n);
+    visitEpoch = 0;
+}
+
+void Puzzle::translate(float dx, float dy)
+{
+    for (Node& pt : nodes)
+    {
+        pt.x += dx;
+        pt.y += dy;
+    }
+}
+
+void Puzzle::reset()
+{
+    std::fill(occupant.begin(), occupant.end(), -1);
+    for (std::size_t i = 0; i < chips.size(); ++i)
+    {
+        chips[i].position = initialPositions[i];
+        occupant[chips[i].position - 1] = static_cast<int32_t>(i);
+    }
+    connectivity.build(*this);
+}
+
+const Node* Puzzle::findNode(int uid) const
+{
+    return valid(uid) ? &nodes[uid - 1] : nullptr;
+}
+
+std::span<const uint32_t> Puzzle::neighbours(int uid) const
+{
+    if (!valid(uid)) return {};
+    return { adjacency.data() + adjacencyStart[uid - 1], adjacency.data() + adjacencyStart[uid] };
+}
+
+int Puzzle::chipIndex(int uid) const
+{
+    for (std::size_t i = 0; i < chips.size(); ++i)
+    {
+        if (static_cast<int>(chips[i].uid) == uid) return static_cast<int>(i);
+    }
+    return -1;
+}
+
+int Puzzle::chipAt(int node) const
+{
+    return valid(node) ? occupant[node - 1] : -1;
+}
+
+bool Puzzle::isOccupied(int node, int ignoreChipUid) const
+{
+    const int chip = chipAt(node);
+    return chip != -1 && static_cast<int>(chips[chip].uid) != ignoreChipUid;
+}
+
+// Fewest hops from start to goal over free nodes, both ends included;
+// empty when the goal is taken, unreachable or the start itself.
+std::vector<int> Puzzle::findPath(int start, int goal, int movingChipUid) const
+{
+    std::vector<int> path;
+    findPath(start, goal, path, movingChipUid);
+    return path;
+}
+
+// Writing into the caller's buffer lets per-frame callers keep its capacity.
+bool Puzzle::findPath(int start, int goal, std::vector<int>& path, int movingChipUid) const
+{
+    expanded = 0;
+    path.clear();
+    if (!valid(start) || !valid(goal) || start == goal) return false;
+    if (isOccupied(goal, movingChipUid)) return false;
+    if (!connectivity.canReach(*this, start, goal)) return false;
+
+    nextEpoch();
+    queue.clear();
+    queue.push_back(start);
+    visitStamp[start - 1] = visitEpoch;
+
+    bool found = false;
+    for (std::size_t head = 0; head < queue.size() && !found; ++head)
+    {
+        const uint32_t current = queue[head];
+        ++expanded;
+        for (uint32_t neighbor : neighbours(current))
+        {
+            if (visitStamp[neighbor - 1] == visitEpoch) continue;
+            if (isOccupied(neighbor, movingChipUid)) continue;
+
+            visitStamp[neighbor - 1] = visitEpoch;
+            cameFrom[neighbor - 1] = current;
+            if (static_cast<int>(neighbor) == goal)
+            {
+                found = true;
+                break;
+            }
+            queue.push_back(neighbor);
+        }
+    }
+
+    if (!found) return false;
+    tracePath(start, goal, path);
+    return true;
+}
+
+// Same contract as findPath, but minimising the drawn length. Edge lengths
+// are the straight-line distances between nodes, so the straight line to
+// the goal never overestimates and the first time the goal is closed its
+// route is the shortest.
+std::vector<int> Puzzle::findRoute(int start, int goal, int movingChipUid) const
+{
+    std::vector<int> path;
+    findRoute(start, goal, path, movingChipUid);
+    return path;
+}
+
+bool Puzzle::findRoute(int start, int goal, std::vector<int>& path, int movingChipUid) const
+{
+    expanded = 0;
+    path.clear();
+    if (!valid(start) || !valid(goal) || start == goal) return false;
+    if (isOccupied(goal, movingChipUid)) return false;
+    if (!connectivity.canReach(*this, start, goal)) return false;
+
+    nextEpoch();
+    const Node& target = nodes[goal - 1];
+    auto estimate = [&](uint32_t uid) {
+        const float dx = target.x - nodes[uid - 1].x;
+        const float dy = target.y - nodes[uid - 1].y;
+        return std::sqrt(dx * dx + dy * dy);
+    };
+    // Non-negative floats order like their bit patterns, so an entry packs
+    // the estimate above the uid and compares as one integer.
+    auto entry = [](float f, uint32_t uid) { return static_cast<uint64_t>(std::bit_cast<uint32_t>(f)) << 32 | uid; };
+    auto byEstimate = std::greater<uint64_t>{};
+
+    open.clear();
+    visitStamp[start - 1] = visitEpoch;
+    distance[start - 1] = 0.0f;
+    open.push_back(entry(estimate(start), start));
+
+    bool found = false;
+    while (!open.empty())
+    {
+        std::pop_heap(open.begin(), open.end(), byEstimate);
+        const uint32_t current = static_cast<uint32_t>(open.back());
+        open.pop_back();
+
+        if (closedStamp[current - 1] == visitEpoch) continue;   // stale entry
+        closedStamp[current - 1] = visitEpoch;
+        ++expanded;
+        if (static_cast<int>(current) == goal)
+        {
+            found = true;
+            break;
+        }
+
+        for (uint32_t k = adjacencyStart[current - 1]; k < adjacencyStart[current]; ++k)
+        {
+            const uint32_t neighbor = adjacency[k];
+            if (closedStamp[neighbor - 1] == visitEpoch || isOccupied(neighbor, movingChipUid)) continue;
+
+            const float through = distance[current - 1] + adjacencyLength[k];
+            if (visitStamp[neighbor - 1] == visitEpoch && through >= distance[neighbor - 1]) continue;
+
+            visitStamp[neighbor - 1] = visitEpoch;
+            distance[neighbor - 1] = through;
+            cameFrom[neighbor - 1] = current;
+            open.push_back(entry(through + estimate(neighbor), neighbor));
+            std::push_heap(open.begin(), open.end(), byEstimate);
+        }
+    }
+
+    if (!found) return false;
+    tracePath(start, goal, path);
+    return true;
+}
+
+void Puzzle::nextEpoch() const
+{
+    expanded = 0;
+    if (++visitEpoch == 0)
+    {
+        std::fill(visitStamp.begin(), visitStamp.end(), 0);
+        std::fill(closedStamp.begin(), closedStamp.end(), 0);
+        visitEpoch = 1;
+    }
+}
+
+void Puzzle::tracePath(int start, int goal, std::vector<int>& path) const
+{
+    path.clear();
+    for (int current = goal; current != start; current = cameFrom[current - 1])
+        path.push_back(current);
+
+    path.push_back(start);
+    std::reverse(path.begin(), path.end());
+}
+
+bool Puzzle::canMove(int chipUid, int to) const
+{
+    const int chip = chipIndex(chipUid);
+    return chip != -1 && valid(to) && connectivity.canReach(*this, chips[chip].position, to);
+}
+
+void Puzzle::destinations(int chipUid, std::vector<int>& out) const
+{
+    const int chip = chipIndex(chipUid);
+    if (chip != -1) connectivity.destinations(*this, chips[chip].position, out);
+}
+
+bool Puzzle::move(int chipUid, int to)
+{
+    if (!canMove(chipUid, to)) return false;
+    place(static_cast<std::size_t>(chipIndex(chipUid)), to);
+    return true;
+}
+
+void Puzzle::place(std::size_t chip, int to)
+{
+    const int from = chips[chip].position;
+    if (from == to) return;
+    occupant[from - 1] = -1;
+    occupant[to - 1] = static_cast<int32_t>(chip);
+    chips[chip].position = to;
+    connectivity.vacate(*this, from);
+    connectivity.occupy(*this, to);
+}
+
+bool Puzzle::isSolved() const
+{
+    const std::size_t count = std::min(chips.size(), targets.size());
+    for (std::size_t i = 0; i < count; ++i)
+    {
+        if (chips[i].position != targets[i]) return false;
+    }
+    return count > 0;
+}
+
+// FNV-1a over the chip positions; equal states hash equal across runs.
+uint64_t Puzzle::hash() const
+{
+    uint64_t h = 0xcbf29ce484222325ull;
+    for (const Chip& chip : chips)
+    {
+        for (int shift = 0; shift < 32; shift += 8)
+        {
+            h ^= (static_cast<uint32_t>(chip.position) >> shift) & 0xFF;
+            h *= 0x100000001b3ull;
+        }
+    }
+    return h;
+}
+
+}
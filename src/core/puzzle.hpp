@@ -0,0 +1,104 @@
+#pragma once
+#include <cstdint>
+#include <cstddef>
+#include <istream>
+#include <span>
+#include <vector>
+#include "connectivity.hpp"
+
+// Game rules without any rendering: the graph, the chips on it, which moves
+// are legal and when the puzzle is solved. Nothing here depends on SFML so
+// solvers and benchmarks can run on headless machines.
+
+namespace cb {
+
+struct Node
+{
+    enum Type { Base, Intersection };
+    uint32_t uid;
+    float x;
+    float y;
+    Type type;
+};
+
+struct Chip
+{
+    uint32_t uid;
+    int position; // current location
+};
+
+// Node uids are 1-based as in the level format and stored densely, so
+// uid - 1 indexes every per-node array. Path queries reuse scratch buffers:
+// a Puzzle may be shared between threads only for reading its state, each
+// thread searching on its own copy.
+class Puzzle
+{
+    public:
+        static Puzzle parse(std::istream&);
+
+        uint32_t addNode(float x, float y);
+        void addConnection(int from, int to);
+        uint32_t placeChip(int position);
+        void setTargets(const std::vector<int>&);
+        void finalize();
+
+        void translate(float dx, float dy);
+        void reset();
+
+        std::size_t nodeCount() const { return nodes.size(); }
+        const std::vector<Node>& getNodes() const { return nodes; }
+        const Node* findNode(int uid) const;
+        const Node& node(int uid) const { return nodes[uid - 1]; }
+        std::span<const uint32_t> neighbours(int uid) const;
+        const std::vector<std::pair<uint32_t, uint32_t>>& getConnections() const { return connections; }
+
+        const std::vector<Chip>& getChips() const { return chips; }
+        const std::vector<int>& getTargets() const { return targets; }
+        const std::vector<int>& getInitialPositions() const { return initialPositions; }
+        int chipIndex(int uid) const;
+        int chipAt(int node) const;                     // chips index or -1
+        const std::vector<int32_t>& getOccupants() const { return occupant; }   // per node uid - 1
+        bool isOccupied(int node, int ignoreChipUid = -1) const;
+
+        // Fewest hops, as the rules count moves
+        std::vector<int> findPath(int start, int goal, int movingChipUid = -1) const;
+        bool findPath(int start, int goal, std::vector<int>& path, int movingChipUid = -1) const;
+        // Shortest on screen: A* over Euclidean edge lengths
+        std::vector<int> findRoute(int start, int goal, int movingChipUid = -1) const;
+        bool findRoute(int start, int goal, std::vector<int>& path, int movingChipUid = -1) const;
+        std::size_t lastSearchExpanded() const { return expanded; }
+        bool canMove(int chipUid, int to) const;
+        void destinations(int chipUid, std::vector<int>& out) const;
+        const Connectivity& freeSpace() const { return connectivity; }
+        bool move(int chipUid, int to);
+        void place(std::size_t chip, int to);           // no legality check
+        bool isSolved() const;
+        uint64_t hash() const;
+
+    private:
+        bool valid(int uid) const { return uid >= 1 && uid <= static_cast<int>(nodes.size()); }
+        void nextEpoch() const;
+        void tracePath(int start, int goal, std::vector<int>& path) const;
+
+        std::vector<Node> nodes;
+        std::vector<std::pair<uint32_t, uint32_t>> connections;
+        std::vector<uint32_t> adjacencyStart;           // compressed rows, built by finalize()
+        std::vector<uint32_t> adjacency;
+        std::vector<float> adjacencyLength;             // Euclidean, parallel to adjacency
+        std::vector<Chip> chips;
+        std::vector<int> initialPositions;
+        std::vector<int> targets;
+        std::vector<int32_t> occupant;                  // per node, chips index or -1
+        Connectivity connectivity;                      // components of the free nodes
+
+        mutable std::vector<uint32_t> visitStamp;
+        mutable std::vector<uint32_t> cameFrom;
+        mutable std::vector<uint32_t> queue;
+        mutable std::vector<uint32_t> closedStamp;
+        mutable std::vector<float> distance;
+        mutable std::vector<uint64_t> open;             // A* heap, see findRoute
+        mutable uint32_t visitEpoch = 0;
+        mutable std::size_t expanded = 0;
+};
+
+}
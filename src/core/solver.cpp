@@ -0,0 +1,164 @@
+#include "solver.hpp"
+#include <algorithm>
+#include <chrono>
+#include <limits>
+#include <stdexcept>
+#include "state_space.hpp"
+#include "thread_pool.hpp"
+
+namespace cb {
+
+namespace {
+
+using namespace search;
+
+constexpr std::size_t chunkStates = 256;
+constexpr int quickWeight = 8;          // greed of solveQuickly: fewer states, longer solutions
+
+struct Successors
+{
+    std::vector<Position> states;
+    std::vector<Step> steps;
+
+    std::size_t bytes() const { return states.capacity() * sizeof(Position) + steps.capacity() * sizeof(Step); }
+};
+
+// Every placement one move away from state that the set has not seen yet.
+void expand(const Puzzle& puzzle, const StateSet& seen, std::size_t width, uint32_t index, Scratch& scratch, Successors& out)
+{
+    forEachMove(puzzle, seen.at(index), width, scratch, [&](std::size_t chip, uint32_t to, const Position* next) {
+        if (seen.contains(next)) return;
+        out.states.insert(out.states.end(), next, next + width);
+        out.steps.push_back(Step{ index, static_cast<uint16_t>(chip), static_cast<uint16_t>(to) });
+    });
+}
+
+}
+
+SolveResult solve(const Puzzle& puzzle, const SolveLimits& limits, ThreadPool* pool)
+{
+    const auto started = std::chrono::steady_clock::now();
+    SolveResult result;
+
+    const auto& chips = puzzle.getChips();
+    const auto& targets = puzzle.getTargets();
+    const std::size_t width = chips.size();
+    const std::size_t goalCount = std::min(width, targets.size());
+    if (goalCount == 0) return result;
+    if (puzzle.nodeCount() > std::numeric_limits<Position>::max())
+        throw std::length_error("solver supports at most 65535 nodes");
+
+    auto isGoal = [&](const Position* state) {
+        for (std::size_t i = 0; i < goalCount; ++i)
+        {
+            if (state[i] != targets[i]) return false;
+        }
+        return true;
+    };
+
+    StateSet seen(width);
+    std::vector<Position> start(width);
+    for (std::size_t i = 0; i < width; ++i) start[i] = static_cast<Position>(chips[i].position);
+    seen.insert(start.data(), Step{ noParent, 0, 0 });
+
+    auto finish = [&](SolveResult::Status status, std::size_t goal) {
+        result.status = status;
+        result.states = seen.size();
+        result.peakBytes = std::max(result.peakBytes, seen.bytes());
+        if (status == SolveResult::Solved)
+        {
+            for (std::size_t i = goal; seen.step(i).parent != noParent; i = seen.step(i).parent)
+                result.solution.push_back(Move{ static_cast<int>(chips[seen.step(i).chip].uid), seen.step(i).to });
+            std::reverse(result.solution.begin(), result.solution.end());
+            result.moves = static_cast<int>(result.solution.size());
+        }
+        result.seconds = std::chrono::duration<double>(std::chrono::steady_clock::now() - started).count();
+        return result;
+    };
+
+    if (isGoal(start.data())) return finish(SolveResult::Solved, 0);
+
+    auto cancelled = [&]() { return limits.cancel && limits.cancel->load(std::memory_order_relaxed); };
+
+    std::size_t layerBegin = 0;
+    std::vector<Successors> buffers;
+    while (layerBegin < seen.size())
+    {
+        if (cancelled()) return finish(SolveResult::Cancelled, 0);
+        const std::size_t layerEnd = seen.size();
+        const std::size_t chunks = (layerEnd - layerBegin + chunkStates - 1) / chunkStates;
+        buffers.resize(chunks);
+
+        auto expandChunk = [&](std::size_t chunk) {
+            thread_local Scratch scratch;
+            scratch.prepare(puzzle.nodeCount());
+            Successors& out = buffers[chunk];
+            out.states.clear();
+            out.steps.clear();
+            if (cancelled()) return;
+            const std::size_t end = std::min(layerEnd, layerBegin + (chunk + 1) * chunkStates);
+            for (std::size_t i = layerBegin + chunk * chunkStates; i < end; ++i)
+                expand(puzzle, seen, width, static_cast<uint32_t>(i), scratch, out);
+        };
+
+        if (pool && chunks > 1) pool->parallelFor(chunks, expandChunk);
+        else for (std::size_t chunk = 0; chunk < chunks; ++chunk) expandChunk(chunk);
+        result.expanded += layerEnd - layerBegin;
+
+        std::size_t pending = seen.bytes();
+        for (const Successors& buffer : buffers) pending += buffer.bytes();
+        result.peakBytes = std::max(result.peakBytes, pending);
+
+        // Chunks only filtered against earlier layers; duplicates between
+        // them are dropped here.
+        for (const Successors& buffer : buffers)
+        {
+            for (std::size_t i = 0; i < buffer.steps.size(); ++i)
+            {
+                const Position* state = buffer.states.data() + i * width;
+                if (!seen.insert(state, buffer.steps[i])) continue;
+                if (isGoal(state)) return finish(SolveResult::Solved, seen.size() - 1);
+                if (seen.size() >= limits.maxStates) return finish(SolveResult::LimitReached, 0);
+            }
+        }
+        layerBegin = layerEnd;
+    }
+
+    return finish(SolveResult::Unsolvable, 0);
+}
+
+SolveResult solveQuickly(const Puzzle& puzzle, const SolveLimits& limits)
+{
+    const auto started = std::chrono::steady_clock::now();
+    SolveResult result;
+
+    const auto& chips = puzzle.getChips();
+    const std::size_t width = chips.size();
+    if (std::min(width, puzzle.getTargets().size()) == 0) return result;
+    if (puzzle.nodeCount() > std::numeric_limits<Position>::max())
+        throw std::length_error("solver supports at most 65535 nodes");
+
+    std::vector<Position> start(width);
+    for (std::size_t i = 0; i < width; ++i) start[i] = static_cast<Position>(chips[i].position);
+
+    Scratch scratch;
+    const BestFirst found = bestFirst(puzzle, start.data(), width, scratch, limits.maxStates, quickWeight, limits.cancel,
+                                      [](const Position*) { return false; });
+
+    if (found.cancelled) result.status = SolveResult::Cancelled;
+    else if (found.arrived) result.status = SolveResult::Solved;
+    else if (found.exhausted) result.status = SolveResult::Unsolvable;
+    else result.status = SolveResult::LimitReached;
+
+    if (result.status == SolveResult::Solved)
+    {
+        for (const Step& step : found.steps)
+            result.solution.push_back(Move{ static_cast<int>(chips[step.chip].uid), step.to });
+        result.moves = static_cast<int>(result.solution.size());
+    }
+    result.states = found.states;
+    result.seconds = std::chrono::duration<double>(std::chrono::steady_clock::now() - started).count();
+    return result;
+}
+
+}
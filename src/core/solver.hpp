@@ -0,0 +1,46 @@
+#pragma once
+#include <atomic>
+#include <cstddef>
+#include <cstdint>
+#include <vector>
+#include "puzzle.hpp"
+
+namespace cb {
+
+class ThreadPool;
+
+struct SolveLimits
+{
+    std::size_t maxStates = std::size_t{ 1 } << 24;
+    const std::atomic<bool>* cancel = nullptr;      // polled between chunks of a layer
+};
+
+struct Move
+{
+    int chip;   // chip uid
+    int to;     // node uid
+};
+
+struct SolveResult
+{
+    enum Status { Solved, Unsolvable, LimitReached, Cancelled };
+
+    Status status = Unsolvable;
+    int moves = -1;                 // optimal, when solved
+    std::size_t expanded = 0;       // states whose successors were generated
+    std::size_t states = 0;         // distinct states discovered
+    std::size_t peakBytes = 0;      // search tables at their largest
+    double seconds = 0.0;
+    std::vector<Move> solution;
+};
+
+// Breadth-first search over chip placements where one move carries a chip
+// along any free path, so the result is the fewest moves. With a pool, wide
+// layers are expanded in parallel and merged on the calling thread.
+SolveResult solve(const Puzzle&, const SolveLimits& = {}, ThreadPool* = nullptr);
+
+// Best-first search towards the chips off target. Finds a solution in far
+// fewer states than solve(), so moves is only an upper bound on the fewest.
+SolveResult solveQuickly(const Puzzle&, const SolveLimits& = {});
+
+}
@@ -0,0 +1,285 @@
+#pragma once
+#include <algorithm>
+#include <atomic>
+#include <cstddef>
+#include <cstdint>
+#include <cstring>
+#include <functional>
+#include <limits>
+#include <queue>
+#include <tuple>
+#include <vector>
+#include "puzzle.hpp"
+
+// Building blocks shared by the searches over chip placements: a state is
+// the node of every chip, in chips order, as 16-bit node uids.
+
+namespace cb::search {
+
+using Position = uint16_t;
+
+constexpr uint32_t noParent = std::numeric_limits<uint32_t>::max();
+constexpr std::size_t npos = std::numeric_limits<std::size_t>::max();
+
+struct Step
+{
+    uint32_t parent;
+    uint16_t chip;      // chips index
+    uint16_t to;
+};
+
+// Fixed-width states stored back to back, found again through an
+// open-addressed table of indices. Lookups are safe from several threads
+// while nothing is inserted.
+class StateSet
+{
+    public:
+        explicit StateSet(std::size_t width): width(width), slots(1024, 0) {}
+
+        std::size_t size() const { return steps.size(); }
+        const Position* at(std::size_t index) const { return data.data() + index * width; }
+        const Step& step(std::size_t index) const { return steps[index]; }
+
+        bool contains(const Position* state) const
+        {
+            return slots[slotFor(state)] != 0;
+        }
+
+        std::size_t find(const Position* state) const
+        {
+            const uint32_t slot = slots[slotFor(state)];
+            return slot == 0 ? npos : slot - 1;
+        }
+
+        bool insert(const Position* state, const Step& step)
+        {
+            if ((size() + 1) * 2 > slots.size()) grow();
+            const std::size_t slot = slotFor(state);
+            if (slots[slot] != 0) return false;
+            data.insert(data.end(), state, state + width);
+            steps.push_back(step);
+            slots[slot] = static_cast<uint32_t>(size());
+            return true;
+        }
+
+        std::size_t bytes() const
+        {
+            return data.capacity() * sizeof(Position) + steps.capacity() * sizeof(Step) + slots.capacity() * sizeof(uint32_t);
+        }
+
+    private:
+        uint64_t hashOf(const Position* state) const
+        {
+            uint64_t h = 0xcbf29ce484222325ull;
+            for (std::size_t i = 0; i < width; ++i)
+            {
+                h ^= state[i];
+                h *= 0x100000001b3ull;
+            }
+            return h ^ (h >> 29);
+        }
+
+        // Slot holding state, or the empty slot where it belongs.
+        std::size_t slotFor(const Position* state) const
+        {
+            const std::size_t mask = slots.size() - 1;
+            std::size_t slot = hashOf(state) & mask;
+            while (slots[slot] != 0 && std::memcmp(at(slots[slot] - 1), state, width * sizeof(Position)) != 0)
+                slot = (slot + 1) & mask;
+            return slot;
+        }
+
+        void grow()
+        {
+            slots.assign(slots.size() * 2, 0);
+            const std::size_t mask = slots.size() - 1;
+            for (std::size_t i = 0; i < size(); ++i)
+            {
+                std::size_t slot = hashOf(at(i)) & mask;
+                while (slots[slot] != 0) slot = (slot + 1) & mask;
+                slots[slot] = static_cast<uint32_t>(i + 1);
+            }
+        }
+
+        std::size_t width;
+        std::vector<Position> data;
+        std::vector<Step> steps;
+        std::vector<uint32_t> slots;    // index + 1, 0 = empty
+};
+
+// Per-thread flood fill buffers, stamped so nothing is cleared per state.
+struct Scratch
+{
+    std::vector<uint32_t> blocked;
+    std::vector<uint32_t> labelled;
+    std::vector<uint32_t> component;            // per node, valid when labelled
+    std::vector<uint32_t> order;                // free nodes, one component after another
+    std::vector<std::pair<uint32_t, uint32_t>> ranges;
+    std::vector<uint32_t> bordering;
+    std::vector<Position> next;
+    uint32_t blockedEpoch = 0;
+    uint32_t labelEpoch = 0;
+
+    void prepare(std::size_t nodes)
+    {
+        if (blocked.size() == nodes) return;
+        blocked.assign(nodes, 0);
+        labelled.assign(nodes, 0);
+        component.assign(nodes, 0);
+        order.reserve(nodes);
+        blockedEpoch = labelEpoch = 0;
+    }
+
+    static uint32_t advance(uint32_t& epoch, std::vector<uint32_t>& stamps)
+    {
+        if (++epoch == 0)
+        {
+            std::fill(stamps.begin(), stamps.end(), 0);
+            epoch = 1;
+        }
+        return epoch;
+    }
+};
+
+// Calls visit(chip index, node uid, resulting state) for every single move
+// from state. Moves are reversible, so this also enumerates predecessors.
+// The free components around the chips are labelled once per state and
+// shared by every chip that borders them, instead of flooding per chip.
+template<class Visit>
+void forEachMove(const Puzzle& puzzle, const Position* state, std::size_t width, Scratch& scratch, Visit&& visit)
+{
+    scratch.next.assign(state, state + width);
+    scratch.order.clear();
+    scratch.ranges.clear();
+
+    const uint32_t blocked = Scratch::advance(scratch.blockedEpoch, scratch.blocked);
+    for (std::size_t c = 0; c < width; ++c) scratch.blocked[state[c] - 1] = blocked;
+    const uint32_t stamp = Scratch::advance(scratch.labelEpoch, scratch.labelled);
+
+    for (std::size_t c = 0; c < width; ++c)
+    {
+        scratch.bordering.clear();
+        for (uint32_t start : puzzle.neighbours(state[c]))
+        {
+            if (scratch.blocked[start - 1] == blocked) continue;
+            if (scratch.labelled[start - 1] != stamp)
+            {
+                const uint32_t label = static_cast<uint32_t>(scratch.ranges.size());
+                const uint32_t first = static_cast<uint32_t>(scratch.order.size());
+                scratch.labelled[start - 1] = stamp;
+                scratch.component[start - 1] = label;
+                scratch.order.push_back(start);
+                for (std::size_t head = first; head < scratch.order.size(); ++head)
+                {
+                    for (uint32_t neighbor : puzzle.neighbours(scratch.order[head]))
+                    {
+                        if (scratch.labelled[neighbor - 1] == stamp || scratch.blocked[neighbor - 1] == blocked) continue;
+                        scratch.labelled[neighbor - 1] = stamp;
+                        scratch.component[neighbor - 1] = label;
+                        scratch.order.push_back(neighbor);
+                    }
+                }
+                scratch.ranges.emplace_back(first, static_cast<uint32_t>(scratch.order.size()));
+            }
+
+            const uint32_t label = scratch.component[start - 1];
+            if (std::find(scratch.bordering.begin(), scratch.bordering.end(), label) == scratch.bordering.end())
+                scratch.bordering.push_back(label);
+        }
+
+        for (uint32_t label : scratch.bordering)
+        {
+            const auto [first, last] = scratch.ranges[label];
+            for (uint32_t i = first; i < last; ++i)
+            {
+                scratch.next[c] = static_cast<Position>(scratch.order[i]);
+                visit(c, scratch.order[i], scratch.next.data());
+            }
+        }
+        scratch.next[c] = state[c];
+    }
+}
+
+struct BestFirst
+{
+    std::vector<Step> steps;        // from the start, in order; parent unused
+    bool arrived = false;           // ended at the goal or where done() said so
+    bool exhausted = false;         // every reachable state seen without arriving
+    bool cancelled = false;
+    std::size_t states = 0;
+};
+
+// Weighted best-first search from start, scored by moves so far plus weight
+// times the chips off target: far fewer states than breadth-first, but not
+// the fewest moves. Ends at the goal or at a state done() accepts; out of
+// states, it settles for the one with the fewest chips off target.
+template<class Done>
+BestFirst bestFirst(const Puzzle& puzzle, const Position* start, std::size_t width, Scratch& scratch,
+                    std::size_t maxStates, int weight, const std::atomic<bool>* cancel, Done&& done)
+{
+    const auto& targets = puzzle.getTargets();
+    const std::size_t goalCount = std::min(width, targets.size());
+    const auto misplaced = [&](const Position* state) {
+        int count = 0;
+        for (std::size_t i = 0; i < goalCount; ++i) count += state[i] != static_cast<Position>(targets[i]);
+        return count;
+    };
+
+    StateSet seen(width);
+    std::vector<int> cost{ 0 };
+    seen.insert(start, Step{ noParent, 0, 0 });
+
+    using Entry = std::tuple<int, int, uint32_t>;   // score, -cost, index
+    std::priority_queue<Entry, std::vector<Entry>, std::greater<Entry>> open;
+    open.emplace(weight * misplaced(start), 0, 0);
+
+    BestFirst result;
+    std::size_t reached = 0;
+    std::size_t expanded = 0;
+    int closest = std::numeric_limits<int>::max();
+    std::vector<Position> state(width);
+    scratch.prepare(puzzle.nodeCount());
+    while (!open.empty())
+    {
+        if (cancel && ++expanded % 1024 == 0 && cancel->load(std::memory_order_relaxed))
+        {
+            result.cancelled = true;
+            return result;
+        }
+
+        const uint32_t index = std::get<2>(open.top());
+        open.pop();
+
+        // Copied out: inserting successors may move the set's storage.
+        state.assign(seen.at(index), seen.at(index) + width);
+        const int left = misplaced(state.data());
+        if (left == 0 || done(state.data()))
+        {
+            reached = index;
+            result.arrived = true;
+            break;
+        }
+        if (left < closest)
+        {
+            closest = left;
+            reached = index;
+        }
+        if (seen.size() >= maxStates) continue;
+
+        const int next = cost[index] + 1;
+        forEachMove(puzzle, state.data(), width, scratch, [&](std::size_t chip, uint32_t to, const Position* after) {
+            if (!seen.insert(after, Step{ index, static_cast<uint16_t>(chip), static_cast<uint16_t>(to) })) return;
+            cost.push_back(next);
+            open.emplace(next + weight * misplaced(after), -next, static_cast<uint32_t>(seen.size() - 1));
+        });
+    }
+
+    result.exhausted = !result.arrived && seen.size() < maxStates;
+    result.states = seen.size();
+    for (std::size_t i = reached; seen.step(i).parent != noParent; i = seen.step(i).parent)
+        result.steps.push_back(seen.step(i));
+    std::reverse(result.steps.begin(), result.steps.end());
+    return result;
+}
+
+}
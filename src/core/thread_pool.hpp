@@ -0,0 +1,132 @@
+#pragma once
+#include <algorithm>
+#include <atomic>
+#include <condition_variable>
+#include <cstddef>
+#include <deque>
+#include <functional>
+#include <future>
+#include <memory>
+#include <mutex>
+#include <thread>
+#include <type_traits>
+#include <vector>
+
+namespace cb {
+
+// Fixed set of workers pulling from one FIFO queue. parallelFor may be called
+// from inside a task: the caller works through the range itself and only
+// waits for items other threads already started, so nested use cannot
+// deadlock even when every worker is busy.
+class ThreadPool
+{
+    public:
+        explicit ThreadPool(unsigned threads = std::thread::hardware_concurrency())
+        {
+            threads = std::max(threads, 1u);
+            workers.reserve(threads);
+            for (unsigned i = 0; i < threads; ++i) workers.emplace_back([this] { run(); });
+        }
+
+        ~ThreadPool()
+        {
+            {
+                std::lock_guard lock(mutex);
+                stopping = true;
+            }
+            wake.notify_all();
+            for (std::thread& worker : workers) worker.join();
+        }
+
+        ThreadPool(const ThreadPool&) = delete;
+        ThreadPool& operator=(const ThreadPool&) = delete;
+
+        unsigned size() const { return static_cast<unsigned>(workers.size()); }
+
+        template<class F>
+        auto submit(F&& task) -> std::future<std::invoke_result_t<F>>
+        {
+            using Result = std::invoke_result_t<F>;
+            auto packaged = std::make_shared<std::packaged_task<Result()>>(std::forward<F>(task));
+            std::future<Result> result = packaged->get_future();
+            {
+                std::lock_guard lock(mutex);
+                tasks.emplace_back([packaged] { (*packaged)(); });
+            }
+            wake.notify_one();
+            return result;
+        }
+
+        // Runs body(i) for every i in [0, count) on the caller and idle workers.
+        void parallelFor(std::size_t count, const std::function<void(std::size_t)>& body)
+        {
+            if (count == 0) return;
+
+            struct Range
+            {
+                const std::function<void(std::size_t)>* body;
+                std::size_t count;
+                std::atomic<std::size_t> next{ 0 };
+                std::atomic<std::size_t> finished{ 0 };
+                std::mutex mutex;
+                std::condition_variable done;
+            };
+            auto range = std::make_shared<Range>();
+            range->body = &body;
+            range->count = count;
+
+            // Helpers that start after the range is exhausted return without
+            // touching body, so it only has to outlive this call.
+            auto work = [range] {
+                std::size_t i;
+                while ((i = range->next.fetch_add(1)) < range->count)
+                {
+                    (*range->body)(i);
+                    if (range->finished.fetch_add(1) + 1 == range->count)
+                    {
+                        std::lock_guard lock(range->mutex);
+                        range->done.notify_all();
+                    }
+                }
+            };
+
+            const std::size_t helpers = std::min<std::size_t>(workers.size(), count - 1);
+            if (helpers > 0)
+            {
+                {
+                    std::lock_guard lock(mutex);
+                    for (std::size_t i = 0; i < helpers; ++i) tasks.emplace_back(work);
+                }
+                wake.notify_all();
+            }
+
+            work();
+            std::unique_lock lock(range->mutex);
+            range->done.wait(lock, [&] { return range->finished.load() == count; });
+        }
+
+    private:
+        void run()
+        {
+            for (;;)
+            {
+                std::function<void()> task;
+                {
+                    std::unique_lock lock(mutex);
+                    wake.wait(lock, [this] { return stopping || !tasks.empty(); });
+                    if (tasks.empty()) return;
+                    task = std::move(tasks.front());
+                    tasks.pop_front();
+                }
+                task();
+            }
+        }
+
+        std::vector<std::thread> workers;
+        std::deque<std::function<void()>> tasks;
+        std::mutex mutex;
+        std::condition_variable wake;
+        bool stopping = false;
+};
+
+}
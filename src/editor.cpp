@@ -0,0 +1,151 @@
+#include "editor.hpp"
+#include <cmath>
+#include "colours.hpp"
+#include "utility.hpp"
+
+namespace cb {
+
+void LevelEditor::begin(const Level& level)
+{
+    draft = LevelDraft::from(level.puzzle, level.boardOffset.x, level.boardOffset.y);
+    offset = level.boardOffset;
+    active = true;
+    selected = chip = -1;
+    moving = false;
+    check(level.puzzle);
+}
+
+bool LevelEditor::press(const sf::Vector2f& world, bool connect)
+{
+    const int node = nodeAt(world);
+    if (node == -1)
+    {
+        const LevelDraft::Point point = toFile(world);
+        selected = draft.addNode(point.x, point.y);
+        return true;
+    }
+
+    if (connect && selected != -1 && selected != node)
+    {
+        draft.toggleConnection(selected, node);
+        selected = node;
+        return true;
+    }
+
+    selected = node;
+    if (const int starting = draft.chipStartingAt(node); starting != -1) chip = starting;
+    moving = true;
+    grabbed = dragged = toWorld(draft.node(node));
+    grabOffset = grabbed - world;
+    return false;
+}
+
+void LevelEditor::drag(const sf::Vector2f& world)
+{
+    if (moving) dragged = world + grabOffset;
+}
+
+bool LevelEditor::release()
+{
+    if (!moving) return false;
+    moving = false;
+    const sf::Vector2f moved = dragged - grabbed;
+    if (std::abs(moved.x) < 1.0f && std::abs(moved.y) < 1.0f) return false;
+
+    const LevelDraft::Point point = toFile(dragged);
+    draft.moveNode(selected, point.x, point.y);
+    return true;
+}
+
+bool LevelEditor::removeSelected()
+{
+    if (selected == -1) return false;
+    if (draft.removeNode(selected) > 0) chip = -1;                 // chip indices moved
+    selected = -1;
+    moving = false;
+    return true;
+}
+
+bool LevelEditor::toggleStart()
+{
+    if (selected == -1) return false;
+    chip = draft.toggleStart(selected);
+    return true;
+}
+
+bool LevelEditor::setTarget()
+{
+    if (selected == -1 || chip == -1) return false;
+    draft.setTarget(static_cast<std::size_t>(chip), selected);
+    return true;
+}
+
+std::string LevelEditor::status() const
+{
+    const SolvabilityChecker::Status check = checker.status();
+    switch (check.state)
+    {
+        case SolvabilityChecker::Status::Idle:
+            return "editing";
+        case SolvabilityChecker::Status::Checking:
+            if (check.bound >= 0) return "checking, solvable in at most " + std::to_string(check.bound) + " moves";
+            return "checking";
+        case SolvabilityChecker::Status::Done:
+            break;
+    }
+    switch (check.result)
+    {
+        case SolveResult::Solved:       return "solvable in " + std::to_string(check.moves) + " moves";
+        case SolveResult::Unsolvable:   return "unsolvable";
+        case SolveResult::LimitReached:
+            if (check.bound >= 0) return "solvable in at most " + std::to_string(check.bound) + " moves, too many states to find the fewest";
+            return "too many states to check";
+        case SolveResult::Cancelled:    break;
+    }
+    return "editing";
+}
+
+void LevelEditor::capture(EditorView& view) const
+{
+    view.active = active;
+    view.selected = active && selected != -1;
+    if (view.selected) view.selection = moving ? dragged : toWorld(draft.node(selected));
+
+    const SolvabilityChecker::Status check = checker.status();
+    if (check.state == SolvabilityChecker::Status::Idle) view.status = hexColor(color::Material::Gray);
+    else if (check.state == SolvabilityChecker::Status::Checking) view.status = hexColor(color::Material::Yellow);
+    else if (check.result == SolveResult::Solved || check.bound >= 0) view.status = hexColor(color::Material::Green);
+    else if (check.result == SolveResult::Unsolvable) view.status = hexColor(color::Material::Error);
+    else view.status = hexColor(color::Material::Orange);
+}
+
+sf::Vector2f LevelEditor::toWorld(const LevelDraft::Point& point) const
+{
+    return sf::Vector2f{ static_cast<float>(point.x), static_cast<float>(point.y) } + offset;
+}
+
+// The nearest node whose cell is under world, as the board hit tests
+int LevelEditor::nodeAt(const sf::Vector2f& world) const
+{
+    constexpr float radius = 24.0f;
+    int nearest = -1;
+    float best = radius;
+    for (int uid = 1; uid <= static_cast<int>(draft.nodeCount()); ++uid)
+    {
+        const float d = distance(world, toWorld(draft.node(uid)));
+        if (d < best)
+        {
+            best = d;
+            nearest = uid;
+        }
+    }
+    return nearest;
+}
+
+LevelDraft::Point LevelEditor::toFile(const sf::Vector2f& world) const
+{
+    const sf::Vector2f file = world - offset;
+    return LevelDraft::Point{ static_cast<int>(std::lround(file.x)), static_cast<int>(std::lround(file.y)) };
+}
+
+}
@@ -0,0 +1,58 @@
+#pragma once
+#include <SFML/Graphics.hpp>
+#include <string>
+#include "level.hpp"
+#include "snapshot.hpp"
+#include "core/checker.hpp"
+#include "core/draft.hpp"
+
+namespace cb {
+
+// In-app level editing. Each edit changes the draft and hands back level
+// text for the board to load as a revision of the live level, which
+// rebuilds only what the edit touched. Once the revision is live its
+// puzzle goes to the solvability checker; the verdict shows in the status.
+//
+// Click empty space to add a node, click a node to select it, drag to move
+// it, shift-click to connect or disconnect it from the selected one.
+class LevelEditor
+{
+    public:
+        // Node uids here are the draft's, which run ahead of the live level
+        // until its revision is swapped in, so presses are hit tested
+        // against the draft's own nodes.
+        void begin(const Level&);
+        void end() { active = false; moving = false; }
+        bool isActive() const { return active; }
+
+        // Each returns true when the draft changed
+        bool press(const sf::Vector2f& world, bool connect);
+        void drag(const sf::Vector2f& world);
+        bool release();
+        bool removeSelected();
+        bool toggleStart();
+        bool setTarget();
+
+        std::string source() const { return draft.serialize(); }
+        void check(const Puzzle& puzzle) { checker.submit(puzzle); }
+        std::string status() const;
+        void capture(EditorView&) const;
+
+    private:
+        sf::Vector2f toWorld(const LevelDraft::Point& point) const;
+        LevelDraft::Point toFile(const sf::Vector2f& world) const;
+        int nodeAt(const sf::Vector2f& world) const;     // draft uid, or -1
+
+        LevelDraft draft;
+        sf::Vector2f offset;                            // file to world, fixed while editing
+        bool active = false;
+        int selected = -1;                              // node uid
+        int chip = -1;                                  // chip index T sets the target of
+        bool moving = false;
+        sf::Vector2f grabbed;                           // world position the drag started at
+        sf::Vector2f grabOffset;                        // node centre from the cursor
+        sf::Vector2f dragged;
+        SolvabilityChecker checker;
+};
+
+}
@@ -0,0 +1,102 @@
+#include "file_watcher.hpp"
+#include <filesystem>
+
+#ifdef __linux__
+#include <poll.h>
+#include <sys/eventfd.h>
+#include <sys/inotify.h>
+#include <unistd.h>
+#endif
+
+namespace cb {
+
+#ifdef __linux__
+
+FileWatcher::FileWatcher()
+{
+    inotifyFd = inotify_init1(IN_NONBLOCK | IN_CLOEXEC);
+    stopFd = eventfd(0, EFD_NONBLOCK | EFD_CLOEXEC);
+    if (inotifyFd >= 0 && stopFd >= 0) worker = std::thread(&FileWatcher::run, this);
+}
+
+FileWatcher::~FileWatcher()
+{
+    if (worker.joinable())
+    {
+        const uint64_t one = 1;
+        [[maybe_unused]] ssize_t written = write(stopFd, &one, sizeof(one));
+        worker.join();
+    }
+    if (inotifyFd >= 0) close(inotifyFd);
+    if (stopFd >= 0) close(stopFd);
+}
+
+void FileWatcher::watch(const std::string& file)
+{
+    if (file == path) return;
+    path = file;
+    seen = changes.load(std::memory_order_acquire);
+
+    std::lock_guard lock(mutex);
+    if (watchDescriptor >= 0) inotify_rm_watch(inotifyFd, watchDescriptor);
+    watchDescriptor = -1;
+    name.clear();
+    if (path.empty() || inotifyFd < 0) return;
+
+    const std::filesystem::path target{ path };
+    const std::string directory = target.has_parent_path() ? target.parent_path().string() : std::string{ "." };
+    name = target.filename().string();
+    watchDescriptor = inotify_add_watch(inotifyFd, directory.c_str(), IN_MODIFY | IN_CLOSE_WRITE | IN_MOVED_TO | IN_CREATE);
+}
+
+void FileWatcher::run()
+{
+    alignas(inotify_event) char buffer[4096];
+    pollfd fds[2] = { { inotifyFd, POLLIN, 0 }, { stopFd, POLLIN, 0 } };
+    bool pending = false;
+    while (true)
+    {
+        // Block until something happens, or while a burst is open until
+        // it has been quiet long enough
+        const int ready = poll(fds, 2, pending ? quietMilliseconds : -1);
+        if (ready < 0) continue;
+        if (fds[1].revents & POLLIN) return;
+        if (ready == 0)
+        {
+            pending = false;
+            changes.fetch_add(1, std::memory_order_release);
+            continue;
+        }
+
+        ssize_t length;
+        while ((length = read(inotifyFd, buffer, sizeof(buffer))) > 0)
+        {
+            std::lock_guard lock(mutex);
+            for (ssize_t at = 0; at < length; )
+            {
+                const auto* event = reinterpret_cast<const inotify_event*>(buffer + at);
+                if (event->wd == watchDescriptor && event->len > 0 && name == event->name) pending = true;
+                at += static_cast<ssize_t>(sizeof(inotify_event) + event->len);
+            }
+        }
+    }
+}
+
+#else
+
+FileWatcher::FileWatcher() {}
+FileWatcher::~FileWatcher() {}
+void FileWatcher::watch(const std::string& file) { path = file; }
+void FileWatcher::run() {}
+
+#endif
+
+bool FileWatcher::changed()
+{
+    const uint64_t now = changes.load(std::memory_order_acquire);
+    if (now == seen) return false;
+    seen = now;
+    return true;
+}
+
+}
@@ -0,0 +1,46 @@
+#pragma once
+#include <atomic>
+#include <cstdint>
+#include <mutex>
+#include <string>
+#include <thread>
+
+namespace cb {
+
+// Watches one file for saves on a thread of its own. Editors write in
+// bursts (truncate, write, rename over, touch), so a change is reported
+// only once the file has been quiet for a moment. Watches the directory
+// rather than the file, since a save by rename replaces the file's inode.
+// Linux only (inotify); elsewhere changed() never fires.
+class FileWatcher
+{
+    public:
+        static constexpr int quietMilliseconds = 50;
+
+        FileWatcher();
+        ~FileWatcher();
+        FileWatcher(const FileWatcher&) = delete;
+        FileWatcher& operator=(const FileWatcher&) = delete;
+
+        // Starts watching path, dropping any earlier one. Empty stops.
+        void watch(const std::string& path);
+        const std::string& watched() const { return path; }
+
+        // True once per settled burst of writes since the last call.
+        bool changed();
+
+    private:
+        void run();
+
+        std::string path;                               // caller's thread only
+        std::mutex mutex;                               // guards the watch descriptor and name
+        std::string name;                               // file name within the watched directory
+        int watchDescriptor = -1;
+        int inotifyFd = -1;
+        int stopFd = -1;
+        std::atomic<uint64_t> changes{ 0 };
+        uint64_t seen = 0;
+        std::thread worker;
+};
+
+}
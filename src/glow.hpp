@@ -0,0 +1,60 @@
+#pragma once
+#include <SFML/Graphics.hpp>
+#include <memory>
+
+namespace cb {
+
+// Soft glows as fragment shaders: one quad computes the falloff that took
+// stacked rings of geometry before. Texture coordinates carry the offset
+// from the shape's centre in units of its radius, and the vertex colour is
+// the glow at full strength.
+
+// Around a pointy-top hexagonal cell, fading from its edge out to `width`
+// radii past it.
+inline constexpr const char* hexGlowSource = R"(
+uniform float width;
+uniform float intensity;
+
+void main()
+{
+    vec2 p = abs(gl_TexCoord[0].xy);
+    float r = max(p.x, dot(p, vec2(0.5, 0.8660254))) / 0.8660254;
+    float t = (r - 1.0) / width;
+    float a = t < 0.0 ? 0.0 : clamp(1.0 - t, 0.0, 1.0);
+    gl_FragColor = vec4(gl_Color.rgb, gl_Color.a * a * intensity);
+}
+)";
+
+// Circular ring fading out from `inner` radii over `thickness` radii.
+inline constexpr const char* ringGlowSource = R"(
+uniform float inner;
+uniform float thickness;
+
+void main()
+{
+    float t = (length(gl_TexCoord[0].xy) - inner) / thickness;
+    float a = t < 0.0 ? 0.0 : clamp(1.0 - t, 0.0, 1.0);
+    gl_FragColor = vec4(gl_Color.rgb, gl_Color.a * a);
+}
+)";
+
+// Null where shaders aren't available or don't compile.
+inline std::unique_ptr<sf::Shader> loadGlowShader(const char* source)
+{
+    if (!sf::Shader::isAvailable()) return nullptr;
+    auto shader = std::make_unique<sf::Shader>();
+    if (!shader->loadFromMemory(source, sf::Shader::Type::Fragment)) return nullptr;
+    return shader;
+}
+
+// Appends a square of two triangles, centre ± extent, with texture
+// coordinates running ± reach across it.
+template<class Out>
+void appendGlowQuad(Out&& out, sf::Vector2f centre, float extent, float reach, sf::Color color)
+{
+    const sf::Vector2f corners[] = { { -1.0f, -1.0f }, { 1.0f, -1.0f }, { 1.0f, 1.0f }, { -1.0f, 1.0f } };
+    for (int i : { 0, 1, 2, 0, 2, 3 })
+        out(sf::Vertex{ centre + corners[i] * extent, color, corners[i] * reach });
+}
+
+}
@@ -1,9 +1,11 @@
 #include <SFML/Graphics.hpp>
+#include <algorithm>
 #include <vector>
 #include <cmath>
 #include <iostream>
 #include "utility.hpp"
 #include "honeycomb.hpp"
+#include "glow.hpp"
 
 namespace cb {
 
@@ -11,16 +13,98 @@ Honeycomb::Honeycomb(sf::Vector2f cellSize, float gap, sf::Color colorOuter, sf:
     :cellSize{cellSize}, gap{gap}, colorOuter{colorOuter}, colorInner{colorInner}
 {
     setGlow(3.0f, 8,  sf::Color{colorOuter.r, colorOuter.g, colorOuter.b, 0x60});
-    generateLayers();
 }
 
-void Honeycomb::generateLayers() 
+int Honeycomb::ringCount(float radius, float step)
+{
+    return std::max(0, static_cast<int>(std::floor(radius / step)));
+}
+
+std::size_t Honeycomb::countFill(Lod lod) const
 {
     const float radius = cellSize.x * 0.5f;
-    drawHexagons(radius);
+    switch (lod)
+    {
+        case Lod::Full:    return 18 * ringCount(radius, gap) + (shaderGlow ? 0 : 36 * glowLayers);
+        case Lod::Reduced: return 18 * ringCount(radius, radius * 0.5f);
+        case Lod::Flat:    return 18;
+        case Lod::Point:   return 6;
+    }
+    return 0;
 }
 
-void Honeycomb::appendGlowRing(float radius) 
+std::size_t Honeycomb::countWire(Lod lod) const
+{
+    const float radius = cellSize.x * 0.5f;
+    switch (lod)
+    {
+        case Lod::Full:    return 12 * ringCount(radius, gap);
+        case Lod::Reduced: return 12 * ringCount(radius, radius * 0.5f);
+        default:           return 0;
+    }
+}
+
+void Honeycomb::writeVertices(Lod lod, sf::Vertex* fill, sf::Vertex* wire) const
+{
+    generateLayers(
+        [&](const sf::Vertex& v) { if (fill) *fill++ = sf::Vertex{ v.position + position, v.color }; },
+        [&](const sf::Vertex& v) { if (wire) *wire++ = sf::Vertex{ v.position + position, v.color }; },
+        lod);
+}
+
+// The quad reaches the corners of the hexagon glowReach radii past the
+// cell; texture coordinates are in cell radii.
+void Honeycomb::writeGlow(sf::Vertex* out) const
+{
+    const float radius = cellSize.x * 0.5f;
+    const float reach = 1.0f + glowReach;
+    appendGlowQuad([&](const sf::Vertex& v) { *out++ = v; }, position, radius * reach, reach, glowColor);
+}
+
+template<class Fill, class Wire>
+void Honeycomb::generateLayers(Fill&& fill, Wire&& wire, Lod lod) const
+{
+    constexpr int sides = 6;
+    const float radius = cellSize.x * 0.5f;
+
+    switch (lod)
+    {
+        case Lod::Full:
+            drawHexagons(fill, wire, radius, gap);
+            if (!shaderGlow) appendGlowRing(fill, radius);
+            break;
+
+        case Lod::Reduced:
+            drawHexagons(fill, wire, radius, radius * 0.5f);
+            break;
+
+        case Lod::Flat:
+        {
+            const sf::Color flat = lerpColor(colorOuter, backgroundColor, 0.5f);
+            for (int j = 0; j < sides; ++j)
+            {
+                const float a0 = sf::degrees(static_cast<float>(j) * 60.f + 30.0f).asRadians();
+                const float a1 = sf::degrees(static_cast<float>(j + 1) * 60.f + 30.0f).asRadians();
+                fill(sf::Vertex{sf::Vector2f{ 0.0f, 0.0f }, flat});
+                fill(sf::Vertex{sf::Vector2f{std::cos(a0) * radius, std::sin(a0) * radius}, flat});
+                fill(sf::Vertex{sf::Vector2f{std::cos(a1) * radius, std::sin(a1) * radius}, flat});
+            }
+            break;
+        }
+
+        case Lod::Point:
+        {
+            const float h = radius * 0.6f;
+            const sf::Vector2f a{ -h, -h }, b{ h, -h }, c{ h, h }, d{ -h, h };
+            for (const sf::Vector2f& p : { a, b, c, a, c, d })
+                fill(sf::Vertex{p, colorOuter});
+            break;
+        }
+    }
+}
+
+template<class Fill>
+void Honeycomb::appendGlowRing(Fill&& fill, float radius) const
 {
     constexpr int sides = 6;
 
@@ -53,28 +137,29 @@ void Honeycomb::appendGlowRing(float radius)
         {
             const int next = (j + 1) % sides;
 
-            fill.append(sf::Vertex{inner[j],    glow});
-            fill.append(sf::Vertex{outer[j],    glow});
-            fill.append(sf::Vertex{outer[next], glow});
+            fill(sf::Vertex{inner[j],    glow});
+            fill(sf::Vertex{outer[j],    glow});
+            fill(sf::Vertex{outer[next], glow});
 
-            fill.append(sf::Vertex{inner[j],    glow});
-            fill.append(sf::Vertex{outer[next], glow});
-            fill.append(sf::Vertex{inner[next], glow});
+            fill(sf::Vertex{inner[j],    glow});
+            fill(sf::Vertex{outer[next], glow});
+            fill(sf::Vertex{inner[next], glow});
         }
     }
 }
 
-void Honeycomb::drawHexagons(float radius) 
+template<class Fill, class Wire>
+void Honeycomb::drawHexagons(Fill&& fill, Wire&& wire, float radius, float step) const
 {
     constexpr int sides = 6;
-    const int q = static_cast<int>(std::floor(radius / gap));
+    const int q = ringCount(radius, step);
 
     for (int i = 0; i < q; ++i) 
     {
-        const float r = radius - i * gap;
+        const float r = radius - i * step;
         if (r <= 0.f) break;
 
-        const float t = static_cast<float>(i) / static_cast<float>(q - 1);
+        const float t = q > 1 ? static_cast<float>(i) / static_cast<float>(q - 1) : 0.0f;
         const sf::Color ringColor = lerpColor(colorOuter, colorInner, t);
 
         std::array<sf::Vector2f, sides> points{};
@@ -89,27 +174,18 @@ void Honeycomb::drawHexagons(float radius)
         for (int j = 0; j < sides; ++j) 
         {
             const int next = (j + 1) % sides;
-            fill.append(sf::Vertex{sf::Vector2f{ 0.0f, 0.0f }, backgroundColor});
-            fill.append(sf::Vertex{points[j], backgroundColor});
-            fill.append(sf::Vertex{points[next], backgroundColor});
+            fill(sf::Vertex{sf::Vector2f{ 0.0f, 0.0f }, backgroundColor});
+            fill(sf::Vertex{points[j], backgroundColor});
+            fill(sf::Vertex{points[next], backgroundColor});
         }
 
         for (int j = 0; j < sides; ++j) 
         {
             const int next = (j + 1) % sides;
-            wire.append(sf::Vertex{points[j], ringColor});
-            wire.append(sf::Vertex{points[next], ringColor});
+            wire(sf::Vertex{points[j], ringColor});
+            wire(sf::Vertex{points[next], ringColor});
         }
     }
-    appendGlowRing(radius);
-}
-
-
-void Honeycomb::draw(sf::RenderTarget& target, sf::RenderStates states) const
-{
-    states.transform.translate(position);
-    target.draw(fill, states);
-    target.draw(wire, states);
 }
 
 
@@ -1,21 +1,41 @@
 #pragma once
 
 #include <SFML/Graphics.hpp>
+#include <atomic>
 #include <vector>
+#include <array>
 #include <cmath>
 #include <iostream>
 #include "utility.hpp"
+#include "lod.hpp"
 
 
 namespace cb {
 
-class Honeycomb: public sf::Drawable 
+class Honeycomb
 {
     public:
         Honeycomb(sf::Vector2f, float, sf::Color, sf::Color);
         void setPosition(sf::Vector2f pos) { position = pos; }
         void setGlow(float r, int l, const sf::Color& col) { glowRadius = r; glowLayers = l; glowColor = col; };
         sf::Vector2f getPosition() const { return position; }
+        sf::Vector2f getSize() const { return cellSize; }
+
+        // The mesh, moved to the honeycomb's position, for level meshes:
+        // triangle and line vertex counts, then the vertices themselves
+        // (either output may be null to skip it).
+        std::size_t countFill(Lod) const;
+        std::size_t countWire(Lod) const;
+        void writeVertices(Lod, sf::Vertex* fill, sf::Vertex* wire) const;
+
+        // With shader glow the Full tier leaves its glow rings out, and
+        // writeGlow() gives one quad per cell for the glow shader instead.
+        // Set once at startup, before any level is baked.
+        static void setShaderGlow(bool enabled) { shaderGlow = enabled; }
+        static bool hasShaderGlow() { return shaderGlow; }
+        std::size_t countGlow() const { return shaderGlow ? 6 : 0; }
+        void writeGlow(sf::Vertex*) const;
+        static constexpr float glowReach = 0.5f;       // widest shader glow, in cell radii past the edge
 
     private:
         sf::Vector2f cellSize;
@@ -27,14 +47,12 @@ class Honeycomb: public sf::Drawable
         float glowRadius = 8.0f;
         int glowLayers = 16;
         sf::Color glowColor;
+        static inline std::atomic<bool> shaderGlow = false;
 
-        sf::VertexArray fill{sf::PrimitiveType::Triangles};
-        sf::VertexArray wire{sf::PrimitiveType::Lines};
-
-        void generateLayers();
-        void appendGlowRing(float);
-        void drawHexagons(float);
-        void draw(sf::RenderTarget&, sf::RenderStates ) const override;
+        static int ringCount(float radius, float step);
+        template<class Fill, class Wire> void generateLayers(Fill&&, Wire&&, Lod) const;
+        template<class Fill> void appendGlowRing(Fill&&, float) const;
+        template<class Fill, class Wire> void drawHexagons(Fill&&, Wire&&, float, float) const;
 };
 
 }
@@ -4,7 +4,9 @@
 #include <array>
 #include <random>
 #include <cmath>
+#include <memory>
 #include "colours.hpp"
+#include "glow.hpp"
 #define M_PI 3.14159265358979323846
 
 namespace cb {
@@ -50,7 +52,8 @@ void drawIdenticon(sf::RenderTarget& target,
                    float scaleFactor = 3.0f,            // 1 = scale factor of circle
                    sf::Color fillColor = sf::Color::White,
                    sf::Color backgroundColor = hexColor(color::Material::Background),
-                   bool bg = true)
+                   bool bg = true,
+                   sf::Shader* ringShader = nullptr)    // draws the glow as one quad when given
 {
     const float circleRadius = circleDiameter / 2.0f;
     const sf::Vector2f center{position.x + circleRadius, position.y + circleRadius};
@@ -97,7 +100,19 @@ void drawIdenticon(sf::RenderTarget& target,
         }
     }
     // Glowing ring
-    if(bg)
+    if(bg && ringShader)
+    {
+        constexpr float inner = 0.9f;       // ring radius, in circle radii
+        constexpr float thickness = 0.4f;
+        ringShader->setUniform("inner", inner);
+        ringShader->setUniform("thickness", thickness);
+
+        sf::VertexArray glow{sf::PrimitiveType::Triangles};
+        appendGlowQuad([&](const sf::Vertex& v) { glow.append(v); }, center, circleRadius * (inner + thickness), inner + thickness,
+                       hexColor(color::Material::Purple));
+        target.draw(glow, sf::RenderStates{ ringShader });
+    }
+    else if(bg)
     {
         sf::VertexArray glow{sf::PrimitiveType::TriangleStrip};
         const int segments = 64;
@@ -124,18 +139,37 @@ void drawIdenticon(sf::RenderTarget& target,
 
 
 
-template <size_t Size>
-std::shared_ptr<sf::Texture> bakeIdenticonTexture(unsigned seed, float diameter, bool bg = true, sf::Color id_color = hexColor(color::Material::Green))
+// Canvas edge per circle diameter. The glow ring reaches 0.65 diameters
+// from the centre, so this leaves it a little room and nothing more.
+constexpr float identiconCanvas = 1.5f;
+
+// Multisampled canvas of one bake: the samples plus the resolved image.
+// Freed once the bake returns.
+constexpr unsigned identiconSamples = 8;
+inline std::size_t identiconCanvasBytes(unsigned diameter)
+{
+    const std::size_t side = static_cast<std::size_t>(std::ceil(diameter * identiconCanvas));
+    return side * side * 4 * (identiconSamples + 1);
+}
+
+// Cells across a baked identicon's grid
+constexpr size_t identiconCells = 5;
+
+// Baked at diameter pixels across the circle, with mipmaps so the sprite
+// stays clean when drawn smaller than that. Without ringShader the ring
+// glow is drawn as a vertex gradient.
+inline std::shared_ptr<sf::Texture> bakeIdenticonTexture(unsigned seed, unsigned diameter, bool bg = true, sf::Color id_color = hexColor(color::Material::Green),
+                                                         sf::Shader* ringShader = nullptr)
 {
-const unsigned imageSize = static_cast<unsigned>(Size * diameter);
+    const unsigned imageSize = static_cast<unsigned>(std::ceil(diameter * identiconCanvas));
 
     sf::ContextSettings settings;
-    settings.antiAliasingLevel = 8;
+    settings.antiAliasingLevel = identiconSamples;
 
     sf::RenderTexture renderTexture({ imageSize, imageSize }, settings);
     renderTexture.clear(sf::Color::Transparent);
 
-    auto grid = generateIdenticon<Size>(seed);
+    auto grid = generateIdenticon<identiconCells>(seed);
     const float radius = diameter * 0.5f;
 
     sf::Vector2f centerPos
@@ -148,18 +182,42 @@ const unsigned imageSize = static_cast<unsigned>(Size * diameter);
         renderTexture,
         grid,
         centerPos,
-        diameter,
+        static_cast<float>(diameter),
         1.7f,
         id_color,
         hexColor(color::Material::Background),
-        bg
+        bg,
+        ringShader
     );
 
     renderTexture.display();
 
     auto texture = std::make_shared<sf::Texture>(renderTexture.getTexture());
     texture->setSmooth(true);
+    (void)texture->generateMipmap();
+
+    return texture;
+}
+
+// Bakes identicons for one owner, on one thread at a time. The ring
+// shader is compiled on the first bake and freed with the baker, so its
+// lifetime is the owner's, which outlives the GL context it bakes in.
+class IdenticonBaker
+{
+    public:
+        std::shared_ptr<sf::Texture> bake(unsigned seed, unsigned diameter, bool bg, sf::Color id_color)
+        {
+            if (!shaderLoaded)
+            {
+                ringShader = loadGlowShader(ringGlowSource);
+                shaderLoaded = true;
+            }
+            return bakeIdenticonTexture(seed, diameter, bg, id_color, ringShader.get());
+        }
 
-    return texture;}
+    private:
+        std::unique_ptr<sf::Shader> ringShader;         // null without shader support
+        bool shaderLoaded = false;
+};
 
 }
@@ -0,0 +1,78 @@
+#pragma once
+#include <SFML/Graphics.hpp>
+#include <algorithm>
+#include <cstdint>
+#include <vector>
+
+namespace cb {
+
+struct InputAction
+{
+    enum Type { MouseDown, MouseMove, MouseUp, Pan, Zoom, ResetView, Key };
+
+    Type type;
+    sf::Vector2f position;      // pixels; the delta for Pan
+    float value = 0.0f;         // Zoom factor
+    int64_t time = 0;           // microseconds, when first polled
+    sf::Keyboard::Key key = sf::Keyboard::Key::Unknown;     // Key, with its modifiers
+    bool shift = false;
+    bool control = false;
+};
+
+// Input gathered over one frame and applied once before rendering. A run of
+// mouse moves collapses to its last position and a run of pans to their sum,
+// so a 1000 Hz mouse costs one board update per frame, not one per report.
+// Other actions, keyboard commands included, keep their order relative to
+// the moves around them.
+class InputQueue
+{
+    public:
+        InputQueue() { actions.reserve(64); }
+
+        void push(const InputAction& action)
+        {
+            ++received;
+            if (!actions.empty() && actions.back().type == action.type)
+            {
+                InputAction& last = actions.back();
+                if (action.type == InputAction::MouseMove)
+                {
+                    last.position = action.position;
+                    return;
+                }
+                if (action.type == InputAction::Pan)
+                {
+                    last.position += action.position;
+                    return;
+                }
+            }
+            actions.push_back(action);
+        }
+
+        // Oldest input still waiting, or -1 when there is none.
+        int64_t oldest() const
+        {
+            int64_t time = -1;
+            for (const InputAction& action : actions)
+                time = time < 0 ? action.time : std::min(time, action.time);
+            return time;
+        }
+
+        template<class F>
+        void drain(F&& apply)
+        {
+            applied += actions.size();
+            for (const InputAction& action : actions) apply(action);
+            actions.clear();
+        }
+
+        std::size_t getReceived() const { return received; }
+        std::size_t getApplied() const { return applied; }
+
+    private:
+        std::vector<InputAction> actions;
+        std::size_t received = 0;
+        std::size_t applied = 0;
+};
+
+}
@@ -0,0 +1,525 @@
+#include "level.hpp"
+#include <fstream>
+#include <sstream>
+#include <iostream>
+#include <algorithm>
+#include <bit>
+#include <limits>
+#include "profiler.hpp"
+#include "resource_cache.hpp"
+
+namespace cb {
+
+std::shared_ptr<Level> Level::load(const std::string& source, bool external, const sf::Vector2f& wsize, const Colorset& colorset,
+                                   ThreadPool* pool, const Level* previous)
+{
+    CB_PROFILE_SCOPE("loadLevel");
+    auto level = std::make_shared<Level>();
+    level->source = source;
+    level->external = external;
+
+    try
+    {
+        if(external)
+        {
+            // Stamped before reading, so a save that lands mid-read leaves
+            // the level stale rather than current
+            std::error_code error;
+            level->fileTime = std::filesystem::last_write_time(source, error);
+            level->fileSize = std::filesystem::file_size(source, error);
+            std::ifstream file(source);
+            if (!file.is_open()) {
+                std::cerr << "Failed to open file: " << source << "\n";
+                return nullptr;
+            }
+            level->parse(file, wsize);
+        }
+        else 
+        {
+            std::istringstream stream(source);
+            level->parse(stream, wsize);
+        }
+    }
+    catch (const std::exception& e)
+    {
+        std::cerr << "Failed to parse level: " << e.what() << "\n";
+        return nullptr;
+    }
+
+    if (previous) level->alignTo(*previous);
+    level->bakeGeometry(colorset, pool, previous);
+    return level;
+}
+
+// Size as well as time, since a quick second save can keep the time
+bool Level::isStale() const
+{
+    if (!external) return false;
+    std::error_code error;
+    const std::filesystem::file_time_type time = std::filesystem::last_write_time(source, error);
+    if (error) return true;
+    const std::uintmax_t size = std::filesystem::file_size(source, error);
+    return error || time != fileTime || size != fileSize;
+}
+
+void Level::bakeGeometry(const Colorset& colorset, ThreadPool* pool, const Level* previous)
+{
+    CB_PROFILE_SCOPE("bakeGeometry");
+    bakedConnections.clear();
+    bakedHoneycombs.clear();
+    honeycombNode.clear();
+
+    std::vector<sf::FloatRect> connectionBounds;
+    std::vector<sf::FloatRect> honeycombBounds;
+    auto box = [](sf::Vector2f a, sf::Vector2f b, float pad) {
+        const sf::Vector2f lo{ std::min(a.x, b.x) - pad, std::min(a.y, b.y) - pad };
+        const sf::Vector2f hi{ std::max(a.x, b.x) + pad, std::max(a.y, b.y) + pad };
+        return sf::FloatRect{ lo, hi - lo };
+    };
+
+    // Connections, each undirected pair once
+    std::vector<uint64_t>& pairs = connectionPairs;
+    pairs.clear();
+    pairs.reserve(puzzle.getConnections().size());
+    for (const auto& [from, to] : puzzle.getConnections())
+    {
+        const auto connection = std::minmax(from, to);
+        pairs.push_back(uint64_t{ connection.first } << 32 | connection.second);
+    }
+    std::sort(pairs.begin(), pairs.end());
+    pairs.erase(std::unique(pairs.begin(), pairs.end()), pairs.end());
+
+    bakedConnections.reserve(pairs.size());
+    connectionBounds.reserve(pairs.size());
+    for (uint64_t pair : pairs)
+    {
+        const Node& p1 = puzzle.node(static_cast<int>(pair >> 32));
+        const Node& p2 = puzzle.node(static_cast<int>(pair & 0xffffffffu));
+
+        bakedConnections.emplace_back
+        (
+            sf::Vector2f(p1.x, p1.y),
+            sf::Vector2f(p2.x, p2.y),
+            8.0f, // thickness
+            colorset.foreground
+        );
+        connectionBounds.push_back(box({ p1.x, p1.y }, { p2.x, p2.y }, 8.0f));
+    }
+
+    // One honeycomb per node in uid order, so a node keeps its item
+    // across versions of the level
+    for (const Node& pt : puzzle.getNodes())
+    {
+        const float size = pt.type == Node::Base ? 68.f : 48.f;
+        Honeycomb honeycomb
+        (
+            sf::Vector2f{size, size}, // cell size
+            4.0f,                     // gap
+            colorset.foreground,
+            colorset.background
+        );
+        honeycomb.setPosition(sf::Vector2f{pt.x, pt.y});
+        bakedHoneycombs.push_back(std::move(honeycomb));
+        honeycombNode.push_back(pt.uid);
+        honeycombBounds.push_back(box({ pt.x, pt.y }, { pt.x, pt.y }, size * 0.5f + 4.0f));
+    }
+
+    // Against a previous version: a node is unchanged if it is where it
+    // was with the same type, a connection if it joins the same two
+    // unchanged nodes. Their vertices are copied rather than regenerated.
+    std::vector<int32_t> honeycombReuse;
+    std::vector<int32_t> connectionReuse;
+    if (previous)
+    {
+        const Puzzle& before = previous->puzzle;
+        auto unchanged = [&](int uid) {
+            if (static_cast<std::size_t>(uid) > before.nodeCount()) return false;
+            const Node& a = puzzle.node(uid);
+            const Node& b = before.node(uid);
+            return a.x == b.x && a.y == b.y && a.type == b.type;
+        };
+
+        honeycombReuse.resize(bakedHoneycombs.size());
+        for (std::size_t i = 0; i < honeycombReuse.size(); ++i)
+            honeycombReuse[i] = unchanged(static_cast<int>(honeycombNode[i])) ? static_cast<int32_t>(i) : -1;
+
+        // Both pair lists are sorted: walk them together
+        connectionReuse.assign(pairs.size(), -1);
+        const std::vector<uint64_t>& old = previous->connectionPairs;
+        std::size_t j = 0;
+        for (std::size_t i = 0; i < pairs.size(); ++i)
+        {
+            while (j < old.size() && old[j] < pairs[i]) ++j;
+            if (j == old.size()) break;
+            if (old[j] == pairs[i] && unchanged(static_cast<int>(pairs[i] >> 32)) && unchanged(static_cast<int>(pairs[i] & 0xffffffffu)))
+                connectionReuse[i] = static_cast<int32_t>(j);
+        }
+    }
+
+    // Full tier vertex data for every item, written in parallel into pages
+    // of one batch per mesh, unless another level with the same geometry
+    // is alive to share its meshes
+    ResourceCache& resources = ResourceCache::shared();
+    std::vector<uint64_t> layout = geometryLayout(colorset);
+    const uint64_t meshKey = geometryKey(layout);
+    meshes = resources.meshes(meshKey);
+    if (meshes && meshes->layout != layout) meshes.reset();         // a hash collision, not the same geometry
+    if (!meshes)
+    {
+        auto built = std::make_shared<LevelMeshes>();
+        built->layout = std::move(layout);
+        const LevelMeshes* before = previous ? previous->meshes.get() : nullptr;
+        auto reuse = [&](const std::vector<int32_t>& map) { return previous ? &map : nullptr; };
+        built->connectionMeshes[0].build(sf::PrimitiveType::Triangles, bakedConnections.size(),
+            [&](std::size_t i) { return bakedConnections[i].countVertices(Lod::Full); },
+            [&](std::size_t i, sf::Vertex* out) { bakedConnections[i].writeVertices(Lod::Full, out); },
+            pool, before ? &before->connectionMeshes[0] : nullptr, reuse(connectionReuse));
+        built->honeycombFill[0].build(sf::PrimitiveType::Triangles, bakedHoneycombs.size(),
+            [&](std::size_t i) { return bakedHoneycombs[i].countFill(Lod::Full); },
+            [&](std::size_t i, sf::Vertex* out) { bakedHoneycombs[i].writeVertices(Lod::Full, out, nullptr); },
+            pool, before ? &before->honeycombFill[0] : nullptr, reuse(honeycombReuse));
+        built->honeycombWire[0].build(sf::PrimitiveType::Lines, bakedHoneycombs.size(),
+            [&](std::size_t i) { return bakedHoneycombs[i].countWire(Lod::Full); },
+            [&](std::size_t i, sf::Vertex* out) { bakedHoneycombs[i].writeVertices(Lod::Full, nullptr, out); },
+            pool, before ? &before->honeycombWire[0] : nullptr, reuse(honeycombReuse));
+        const bool glowReusable = before && before->honeycombGlow.items() == previous->bakedHoneycombs.size();
+        built->honeycombGlow.build(sf::PrimitiveType::Triangles, Honeycomb::hasShaderGlow() ? bakedHoneycombs.size() : 0,
+            [&](std::size_t i) { return bakedHoneycombs[i].countGlow(); },
+            [&](std::size_t i, sf::Vertex* out) { bakedHoneycombs[i].writeGlow(out); },
+            pool, glowReusable ? &before->honeycombGlow : nullptr, glowReusable ? reuse(honeycombReuse) : nullptr);
+        built->built[0].store(true, std::memory_order_release);
+        meshes = resources.publish(meshKey, built);
+        if (meshes->layout != built->layout) meshes = std::move(built);   // collided: keep it to ourselves
+    }
+    geometryUploaded = false;
+
+    connectionGrid.build(connectionBounds);
+    honeycombGrid.build(honeycombBounds);
+
+    textures.reset();
+    baking = std::make_shared<TextureSet>();
+    baking->resolution = defaultResolution;
+    textureCursor = 0;
+}
+
+
+// The GL half of baking; the CPU half already ran on the loader.
+void Level::uploadGeometry()
+{
+    CB_PROFILE_SCOPE("uploadGeometry");
+    meshes->upload();
+    geometryUploaded = true;
+}
+
+// Most boards are never zoomed out far enough to need the coarse tiers,
+// so they are left until the renderer picks one. Built on the thread that
+// draws, without the loader's pool; they are a few vertices per cell.
+void Level::prepareLod(Lod lod) const
+{
+    LevelMeshes& set = *meshes;
+    if (lod == Lod::Full || set.hasTier(lod)) return;
+    CB_PROFILE_SCOPE("prepareLod");
+    std::lock_guard lock(set.building);
+    if (set.hasTier(lod)) return;
+
+    if (!set.hasCentreLines())
+    {
+        set.connectionMeshes[1].build(sf::PrimitiveType::Lines, bakedConnections.size(),
+            [&](std::size_t i) { return bakedConnections[i].countVertices(lod); },
+            [&](std::size_t i, sf::Vertex* out) { bakedConnections[i].writeVertices(lod, out); });
+        set.connectionMeshes[1].upload();
+    }
+    const std::size_t tier = static_cast<std::size_t>(lod);
+    set.honeycombFill[tier].build(sf::PrimitiveType::Triangles, bakedHoneycombs.size(),
+        [&](std::size_t i) { return bakedHoneycombs[i].countFill(lod); },
+        [&](std::size_t i, sf::Vertex* out) { bakedHoneycombs[i].writeVertices(lod, out, nullptr); });
+    set.honeycombWire[tier].build(sf::PrimitiveType::Lines, bakedHoneycombs.size(),
+        [&](std::size_t i) { return bakedHoneycombs[i].countWire(lod); },
+        [&](std::size_t i, sf::Vertex* out) { bakedHoneycombs[i].writeVertices(lod, nullptr, out); });
+    set.honeycombFill[tier].upload();
+    set.honeycombWire[tier].upload();
+    set.built[tier].store(true, std::memory_order_release);
+}
+
+// Pages already uploaded for a level sharing them are skipped. Coarse
+// tiers upload themselves as they are built.
+void LevelMeshes::upload()
+{
+    connectionMeshes[0].upload();
+    honeycombFill[0].upload();
+    honeycombWire[0].upload();
+    honeycombGlow.upload();
+}
+
+// Tiers not built yet hold nothing, and may be being built on another thread
+std::size_t LevelMeshes::memoryBytes() const
+{
+    std::size_t bytes = sizeof(LevelMeshes) + layout.capacity() * sizeof(uint64_t);
+    if (hasCentreLines()) bytes += connectionMeshes[1].memoryBytes();
+    for (std::size_t tier = 0; tier < lodCount; ++tier)
+    {
+        if (!hasTier(static_cast<Lod>(tier))) continue;
+        if (tier == 0) bytes += connectionMeshes[0].memoryBytes() + honeycombGlow.memoryBytes();
+        bytes += honeycombFill[tier].memoryBytes() + honeycombWire[tier].memoryBytes();
+    }
+    return bytes;
+}
+
+std::size_t LevelMeshes::bufferBytes(std::unordered_set<const void*>& seen) const
+{
+    std::size_t bytes = 0;
+    if (hasCentreLines()) bytes += connectionMeshes[1].bufferBytes(seen);
+    for (std::size_t tier = 0; tier < lodCount; ++tier)
+    {
+        if (!hasTier(static_cast<Lod>(tier))) continue;
+        if (tier == 0) bytes += connectionMeshes[0].bufferBytes(seen) + honeycombGlow.bufferBytes(seen);
+        bytes += honeycombFill[tier].bufferBytes(seen) + honeycombWire[tier].bufferBytes(seen);
+    }
+    return bytes;
+}
+
+// Everything the meshes are built from, word by word: node positions and
+// types, the connections, the colours and whether glows are shader drawn.
+// Two levels with the same layout have identical vertex data, whatever
+// their source.
+std::vector<uint64_t> Level::geometryLayout(const Colorset& colorset) const
+{
+    auto bits = [](float value) { return uint64_t{ std::bit_cast<uint32_t>(value) }; };
+    std::vector<uint64_t> layout;
+    layout.reserve(3 + 3 * puzzle.nodeCount() + connectionPairs.size());
+    layout.push_back(puzzle.nodeCount());
+    for (const Node& node : puzzle.getNodes())
+    {
+        layout.push_back(bits(node.x));
+        layout.push_back(bits(node.y));
+        layout.push_back(static_cast<uint64_t>(node.type));
+    }
+    layout.push_back(connectionPairs.size());
+    layout.insert(layout.end(), connectionPairs.begin(), connectionPairs.end());
+    layout.push_back(uint64_t{ colorset.foreground.toInteger() } << 32 | colorset.background.toInteger());
+    layout.push_back(Honeycomb::hasShaderGlow());
+    return layout;
+}
+
+uint64_t Level::geometryKey(const std::vector<uint64_t>& layout)
+{
+    uint64_t hash = 0xcbf29ce484222325ull;
+    for (uint64_t value : layout)
+    {
+        for (int i = 0; i < 8; ++i, value >>= 8)
+        {
+            hash ^= value & 0xff;
+            hash *= 0x100000001b3ull;
+        }
+    }
+    return hash;
+}
+
+// Moves a new version of a level into the old one's frame, so nodes that
+// didn't change stay where they were on screen.
+void Level::alignTo(const Level& previous)
+{
+    const sf::Vector2f shift = previous.boardOffset - boardOffset;
+    if (shift == sf::Vector2f{}) return;
+
+    puzzle.translate(shift.x, shift.y);
+    boardOffset = previous.boardOffset;
+    boardBounds.position += shift;
+    hintCenterY += shift.y;
+}
+
+// Back to the starting layout, e.g. when a cached level is revisited.
+void Level::reset()
+{
+    puzzle.reset();
+}
+
+// Rough resident footprint: textures, baked vertices and the graph itself.
+std::size_t Level::memoryBytes() const
+{
+    std::size_t bytes = sizeof(Level);
+
+    if (textures) bytes += textures->memoryBytes();
+    if (baking) bytes += baking->memoryBytes();
+
+    bytes += bakedConnections.capacity() * sizeof(PolyLine) + bakedHoneycombs.capacity() * sizeof(Honeycomb);
+    bytes += meshes->memoryBytes();
+
+    bytes += puzzle.nodeCount() * (sizeof(Node) + 2 * sizeof(uint32_t));
+    bytes += puzzle.getConnections().size() * 4 * sizeof(uint32_t);
+
+    return bytes;
+}
+
+// Chip and hint identicons, as many as fit in the budget; true once all are
+// done and the new set has replaced the old one.
+bool Level::bakeTextures(IdenticonBaker& baker, float budgetMilliseconds)
+{
+    if (!geometryUploaded) uploadGeometry();
+    if (!baking) return true;
+    CB_PROFILE_SCOPE("bakeTextures");
+    sf::Clock clock;
+
+    const std::vector<Chip>& chips = puzzle.getChips();
+    while (textureCursor < chips.size())
+    {
+        const Chip& chip = chips[textureCursor];
+        if (!baking->chips.count(chip.uid))
+            baking->chips[chip.uid] = identicon(baker, chip.uid, baking->resolution, true, hexColor(color::Material::Green));
+
+        if (textureCursor < puzzle.getTargets().size() && !baking->hints.count(chip.uid))
+            baking->hints[chip.uid] = identicon(baker, chip.uid, baking->resolution, false, sf::Color::White);
+
+        ++textureCursor;
+        if (clock.getElapsedTime().asSeconds() * 1000.0f >= budgetMilliseconds) break;
+    }
+    if (textureCursor < chips.size()) return false;
+
+    textures = std::move(baking);
+    return true;
+}
+
+// Through the process-wide cache, so boards on the same level bake each
+// identicon once.
+std::shared_ptr<sf::Texture> Level::identicon(IdenticonBaker& baker, unsigned seed, unsigned diameter, bool background, sf::Color color)
+{
+    const ResourceCache::IdenticonKey key{ seed, diameter, background, color.toInteger() };
+    return ResourceCache::shared().identicon(key, [&] { return baker.bake(seed, diameter, background, color); });
+}
+
+// Identicons depend only on the chip uid, so every chip the previous
+// version had keeps its textures.
+void Level::adoptTextures(const Level& previous)
+{
+    const TextureSet* from = previous.textures.get();
+    if (!from) return;
+
+    baking = std::make_shared<TextureSet>();
+    baking->resolution = from->resolution;
+    for (const Chip& chip : puzzle.getChips())
+    {
+        if (auto it = from->chips.find(chip.uid); it != from->chips.end()) baking->chips.insert(*it);
+        if (auto it = from->hints.find(chip.uid); it != from->hints.end()) baking->hints.insert(*it);
+    }
+    textureCursor = 0;
+}
+
+void Level::dropTextures()
+{
+    textures.reset();
+    baking.reset();
+    textureCursor = 0;
+}
+
+// A set being baked counts only the textures the set in use doesn't share,
+// and the canvas of its next bake while it has chips left.
+void Level::measure(MemoryUsage& usage, std::unordered_set<const void*>& seen) const
+{
+    auto add = [&seen](const TextureSet& set, std::size_t& bytes) {
+        for (const auto* textures : { &set.chips, &set.hints })
+        {
+            for (const auto& [_, texture] : *textures)
+            {
+                if (seen.insert(texture.get()).second) bytes += TextureSet::textureBytes(*texture);
+            }
+        }
+    };
+    if (textures) add(*textures, usage.textures);
+    if (baking)
+    {
+        add(*baking, usage.baking);
+        if (textureCursor < puzzle.getChips().size()) usage.baking += identiconCanvasBytes(baking->resolution);
+    }
+    if (geometryUploaded) usage.vertexBuffers += meshes->bufferBytes(seen);
+}
+
+void Level::requestResolution(unsigned pixels)
+{
+    if (baking ? baking->resolution == pixels : textureResolution() == pixels) return;
+
+    textureCursor = 0;
+    if (textureResolution() == pixels)
+    {
+        baking.reset();         // back to the set already in use
+        return;
+    }
+    baking = std::make_shared<TextureSet>();
+    baking->resolution = pixels;
+}
+
+std::size_t TextureSet::memoryBytes() const
+{
+    std::size_t bytes = 0;
+    for (const auto* textures : { &chips, &hints })
+    {
+        for (const auto& [_, texture] : *textures) bytes += textureBytes(*texture);
+    }
+    return bytes;
+}
+
+// What dropping the set would free. Identicons are shared through the
+// ResourceCache, whose entries are weak, so a texture only this set holds
+// has a use count of one.
+std::size_t TextureSet::exclusiveBytes() const
+{
+    std::size_t bytes = 0;
+    for (const auto* textures : { &chips, &hints })
+    {
+        for (const auto& [_, texture] : *textures)
+            if (texture.use_count() == 1) bytes += textureBytes(*texture);
+    }
+    return bytes;
+}
+
+// RGBA plus its mip chain, which adds a third.
+std::size_t TextureSet::textureBytes(const sf::Texture& texture)
+{
+    return static_cast<std::size_t>(texture.getSize().x) * texture.getSize().y * 4 * 4 / 3;
+}
+
+void Level::parse(std::istream& file, const sf::Vector2f& wsize)
+{
+    puzzle = Puzzle::parse(file);
+
+    float minX = std::numeric_limits<float>::max();
+    float maxX = std::numeric_limits<float>::lowest();
+    float minY = std::numeric_limits<float>::max();
+    float maxY = std::numeric_limits<float>::lowest();
+
+    for (const Node& pt : puzzle.getNodes())
+    {
+        minX = std::min(minX, pt.x);
+        maxX = std::max(maxX, pt.x);
+        minY = std::min(minY, pt.y);
+        maxY = std::max(maxY, pt.y);
+    }
+
+    const sf::Vector2f boardCenter = {
+        (minX + maxX) / 2.0f,
+        (minY + maxY) / 2.0f
+    };
+
+    const sf::Vector2f windowCenter = {
+        wsize.x / 2.0f,
+        wsize.y / 2.0f
+    };
+
+    boardOffset = windowCenter - boardCenter;
+    const std::size_t count = puzzle.nodeCount();
+    if (count > 0) puzzle.translate(boardOffset.x, boardOffset.y);
+
+    hintCenterY = 0.0f;
+    for (const Node& pt : puzzle.getNodes()) hintCenterY += pt.y;
+    if (count > 0) hintCenterY /= static_cast<float>(count);
+
+    boardBounds = count == 0
+        ? sf::FloatRect{ {}, wsize }
+        : sf::FloatRect{ sf::Vector2f{ minX, minY } + boardOffset, sf::Vector2f{ maxX - minX, maxY - minY } };
+
+    hintAt.clear();
+    const std::vector<int>& targets = puzzle.getTargets();
+    for (std::size_t i = 0; i < targets.size(); ++i)
+        hintAt[targets[i]] = i;
+}
+
+}
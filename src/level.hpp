@@ -0,0 +1,152 @@
+#pragma once
+#include <array>
+#include <atomic>
+#include <cstdint>
+#include <filesystem>
+#include <mutex>
+#include <unordered_map>
+#include <unordered_set>
+#include <memory>
+#include <string>
+#include <istream>
+#include "polyline.hpp"
+#include "honeycomb.hpp"
+#include "identicon.hpp"
+#include "colours.hpp"
+#include "spatial.hpp"
+#include "mesh_batch.hpp"
+#include "core/puzzle.hpp"
+
+namespace cb {
+
+struct Colorset
+{
+    sf::Color background    { hexColor(color::Material::Background) };
+    sf::Color foreground    { hexColor(color::Material::Blue)       };
+    sf::Color inactiveHint  { hexColor(color::Material::Disabled)   };
+    sf::Color activeHint    { hexColor(color::Material::Blue)       };
+    sf::Color path          { hexColor(color::Material::Purple)     };
+    sf::Color selected      { hexColor(color::Material::Purple)     };
+    sf::Color error         { hexColor(color::Material::Error)      };
+};
+
+// GPU memory a board holds, in bytes; resources shared with other levels or
+// boards count once.
+struct MemoryUsage
+{
+    std::size_t textures = 0;                   // identicons in use, with mipmaps
+    std::size_t vertexBuffers = 0;              // uploaded mesh pages
+    std::size_t baking = 0;                     // identicons baked but not yet in use, and the canvas of the next bake
+
+    std::size_t textureTotal() const { return textures + baking; }
+};
+
+// Chip and hint identicons baked for one on-screen size. Never changed once
+// published, so a snapshot can keep drawing a set while its level bakes the
+// replacement for a new zoom.
+struct TextureSet
+{
+    unsigned resolution = 0;                        // circle diameter, pixels
+    std::unordered_map<int, std::shared_ptr<sf::Texture>> chips;
+    std::unordered_map<int, std::shared_ptr<sf::Texture>> hints;
+
+    std::size_t memoryBytes() const;
+    std::size_t exclusiveBytes() const;             // textures nothing else holds
+    static std::size_t textureBytes(const sf::Texture&);
+};
+
+// Vertex data of a level's connections and cells. Levels with identical
+// geometry share one set through the ResourceCache. The Full tier is built
+// with the level, the coarser ones when the renderer first selects them
+// (Level::prepareLod); a tier never changes once built. upload() only adds
+// the GPU copies of the Full tier, on the GL thread.
+struct LevelMeshes
+{
+    std::array<MeshBatch, 2> connectionMeshes;      // full, centre line
+    std::array<MeshBatch, lodCount> honeycombFill;  // per Lod
+    std::array<MeshBatch, lodCount> honeycombWire;
+    MeshBatch honeycombGlow;                        // Full tier glow quads; empty without shader glow
+    std::vector<uint64_t> layout;                   // what it was built from, see Level::geometryLayout
+    std::array<std::atomic<bool>, lodCount> built{};  // per Lod; centre lines come with the first coarse tier
+    std::mutex building;                            // held while a coarse tier is built
+
+    bool hasTier(Lod lod) const { return built[static_cast<std::size_t>(lod)].load(std::memory_order_acquire); }
+    bool hasCentreLines() const { return hasTier(Lod::Reduced) || hasTier(Lod::Flat) || hasTier(Lod::Point); }
+    void upload();
+    std::size_t memoryBytes() const;
+    std::size_t bufferBytes(std::unordered_set<const void*>& seen) const;
+};
+
+// Everything a loaded level owns. parse() and bakeGeometry() touch only CPU
+// memory and may run on any thread; bakeTextures() needs a GL context, and
+// uploads the geometry before baking identicons in small slices on the
+// thread that owns the level.
+struct Level
+{
+    // With previous, the result is a new version of that level: it keeps
+    // the old placement on screen, and geometry the two share is reused.
+    static std::shared_ptr<Level> load(const std::string&, bool external, const sf::Vector2f& wsize, const Colorset&,
+                                       ThreadPool* = nullptr, const Level* previous = nullptr);
+
+    void parse(std::istream&, const sf::Vector2f& wsize);
+    void alignTo(const Level& previous);
+    void bakeGeometry(const Colorset&, ThreadPool* = nullptr, const Level* previous = nullptr);
+    bool bakeTextures(IdenticonBaker&, float budgetMilliseconds);
+    bool isBaked() const { return !baking; }
+    // Builds and uploads a coarse tier of the meshes the first time it is
+    // drawn; needs a GL context.
+    void prepareLod(Lod) const;
+    void skipTextures() { baking.reset(); }
+    // Rebakes the identicons at another resolution; the current set stays
+    // in use until the new one is complete.
+    void requestResolution(unsigned pixels);
+    unsigned textureResolution() const { return textures ? textures->resolution : 0; }
+    // Starts baking from previous's identicons; only chips it lacks are baked.
+    void adoptTextures(const Level& previous);
+    // Frees the identicons; they are baked again when next requested.
+    void dropTextures();
+    void reset();
+    std::size_t memoryBytes() const;
+    // Adds what the level holds on the GPU to usage, skipping resources
+    // already in seen.
+    void measure(MemoryUsage& usage, std::unordered_set<const void*>& seen) const;
+
+    static std::string makeKey(const std::string& source, bool external) { return (external ? "file:" : "text:") + source; }
+    std::string key() const { return makeKey(source, external); }
+    // True for an external level whose file has changed since it was read
+    bool isStale() const;
+
+    std::string source;
+    bool external = false;
+    std::filesystem::file_time_type fileTime{};     // external: as read
+    std::uintmax_t fileSize = 0;
+
+    Puzzle puzzle;
+    std::vector<PolyLine> bakedConnections;         // shapes, in mesh item order
+    std::vector<uint64_t> connectionPairs;          // sorted (low << 32 | high), per connection item
+    std::vector<Honeycomb> bakedHoneycombs;
+    std::shared_ptr<LevelMeshes> meshes = std::make_shared<LevelMeshes>();
+    std::shared_ptr<const TextureSet> textures;     // null until the first set is baked
+    static constexpr float chipDiameter = 48.0f;    // world units
+    static constexpr unsigned defaultResolution = 64;
+
+    SpatialGrid connectionGrid;                     // indexes bakedConnections
+    SpatialGrid honeycombGrid;                      // indexes bakedHoneycombs
+    std::vector<uint32_t> honeycombNode;            // bakedHoneycombs index -> node uid
+    std::unordered_map<int, std::size_t> hintAt;    // node uid -> targetPositions index
+    sf::FloatRect boardBounds;
+    sf::Vector2f boardOffset;                       // level file to world coordinates
+    float hintCenterY = 0.0f;
+
+    private:
+        void uploadGeometry();
+        std::vector<uint64_t> geometryLayout(const Colorset&) const;
+        static uint64_t geometryKey(const std::vector<uint64_t>& layout);
+        static std::shared_ptr<sf::Texture> identicon(IdenticonBaker&, unsigned seed, unsigned diameter, bool background, sf::Color);
+
+        std::shared_ptr<TextureSet> baking;
+        bool geometryUploaded = false;
+        std::size_t textureCursor = 0;
+};
+
+}
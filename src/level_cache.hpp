@@ -0,0 +1,111 @@
+#pragma once
+#include <cstddef>
+#include <list>
+#include <memory>
+#include <string>
+#include <unordered_map>
+#include "level.hpp"
+
+namespace cb {
+
+// Fully baked levels, least recently used evicted first once their
+// estimated footprint exceeds the budget. Keys name a level, not a version
+// of it, so a level whose file has changed since is dropped when taken.
+class LevelCache
+{
+    public:
+        explicit LevelCache(std::size_t budgetBytes): budget(budgetBytes) {}
+
+        bool contains(const std::string& key) const { return index.count(key) != 0; }
+        std::size_t size() const { return entries.size(); }
+        std::size_t bytes() const { return used; }
+
+        void setBudget(std::size_t budgetBytes)
+        {
+            budget = budgetBytes;
+            evict();
+        }
+
+        // Hands the level over to the caller, who owns it from now on;
+        // null if it isn't cached or is stale.
+        std::shared_ptr<Level> take(const std::string& key)
+        {
+            auto it = index.find(key);
+            if (it == index.end()) return nullptr;
+
+            std::shared_ptr<Level> level = std::move(it->second->level);
+            used -= it->second->bytes;
+            entries.erase(it->second);
+            index.erase(it);
+            return level->isStale() ? nullptr : level;
+        }
+
+        void insert(std::shared_ptr<Level> level)
+        {
+            if (!level || !level->isBaked()) return;
+            const std::string key = level->key();
+            take(key);
+
+            const std::size_t bytes = level->memoryBytes();
+            if (bytes > budget) return;
+
+            entries.push_front(Entry{ key, std::move(level), bytes });
+            index[key] = entries.begin();
+            used += bytes;
+            evict();
+        }
+
+        // Frees identicons of the least recently used levels until about
+        // bytes are gone. Only textures no other level holds count; a
+        // level whose identicons are all shared keeps them, as dropping
+        // them would free nothing. The levels stay cached and bake again
+        // before they are swapped in. Returns the bytes freed.
+        std::size_t shedTextures(std::size_t bytes)
+        {
+            std::size_t freed = 0;
+            for (auto it = entries.rbegin(); it != entries.rend() && freed < bytes; ++it)
+            {
+                const std::shared_ptr<const TextureSet>& textures = it->level->textures;
+                if (!textures || textures.use_count() > 1) continue;
+                const std::size_t exclusive = textures->exclusiveBytes();
+                if (exclusive == 0) continue;
+                freed += exclusive;
+                it->level->dropTextures();
+                used -= it->bytes;
+                it->bytes = it->level->memoryBytes();
+                used += it->bytes;
+            }
+            return freed;
+        }
+
+        template<class Visit>
+        void forEach(Visit&& visit) const
+        {
+            for (const Entry& entry : entries) visit(*entry.level);
+        }
+
+    private:
+        struct Entry
+        {
+            std::string key;
+            std::shared_ptr<Level> level;
+            std::size_t bytes;
+        };
+
+        void evict()
+        {
+            while (used > budget && !entries.empty())
+            {
+                used -= entries.back().bytes;
+                index.erase(entries.back().key);
+                entries.pop_back();
+            }
+        }
+
+        std::size_t budget;
+        std::size_t used = 0;
+        std::list<Entry> entries;
+        std::unordered_map<std::string, std::list<Entry>::iterator> index;
+};
+
+}
@@ -1,4 +1,5 @@
 #pragma once
+#include <array>
 
 inline const char* level1 = R"(
 6
@@ -107,3 +108,5 @@ inline const char* level3 = R"(
 12,13
 13,14
 )";
+
+inline const std::array<const char*, 3> builtinLevels{ level1, level2, level3 };
@@ -0,0 +1,74 @@
+#include "loader.hpp"
+#include <utility>
+
+namespace cb {
+
+LevelLoader::LevelLoader(const sf::Vector2f& wsize, const Colorset& colorset)
+    : wsize(wsize), colorset(colorset), worker(&LevelLoader::run, this)
+{
+}
+
+LevelLoader::~LevelLoader()
+{
+    {
+        std::lock_guard lock(mutex);
+        stopping = true;
+        pending.reset();
+    }
+    wake.notify_one();
+    worker.join();
+}
+
+void LevelLoader::request(const std::string& source, bool external, std::shared_ptr<const Level> previous)
+{
+    {
+        std::lock_guard lock(mutex);
+        pending = Request{ source, external, std::move(previous), ++latest };
+        finished.reset();
+        failed.clear();
+    }
+    wake.notify_one();
+}
+
+std::shared_ptr<Level> LevelLoader::poll()
+{
+    std::lock_guard lock(mutex);
+    return std::move(finished);
+}
+
+std::string LevelLoader::pollFailure()
+{
+    std::lock_guard lock(mutex);
+    return std::exchange(failed, std::string{});
+}
+
+bool LevelLoader::busy() const
+{
+    std::lock_guard lock(mutex);
+    return working || pending.has_value();
+}
+
+void LevelLoader::run()
+{
+    std::unique_lock lock(mutex);
+    while (true)
+    {
+        wake.wait(lock, [&]() { return stopping || pending.has_value(); });
+        if (stopping) return;
+
+        Request job = std::move(*pending);
+        pending.reset();
+        working = true;
+
+        lock.unlock();
+        std::shared_ptr<Level> level = Level::load(job.source, job.external, wsize, colorset, &pool, job.previous.get());
+        lock.lock();
+
+        working = false;
+        if (job.generation != latest) continue;
+        if (level) finished = std::move(level);
+        else failed = Level::makeKey(job.source, job.external);
+    }
+}
+
+}
@@ -0,0 +1,60 @@
+#pragma once
+#include <cstdint>
+#include <memory>
+#include <mutex>
+#include <condition_variable>
+#include <thread>
+#include <optional>
+#include <string>
+#include "level.hpp"
+#include "core/thread_pool.hpp"
+
+namespace cb {
+
+// Background worker that parses levels and builds their geometry. Only the
+// most recent request matters: older ones are dropped if still queued and
+// their results discarded if already running.
+class LevelLoader
+{
+    public:
+        LevelLoader(const sf::Vector2f& wsize, const Colorset& colorset);
+        ~LevelLoader();
+        LevelLoader(const LevelLoader&) = delete;
+        LevelLoader& operator=(const LevelLoader&) = delete;
+
+        // previous, when given, is an earlier version of the same level:
+        // its unchanged geometry is reused rather than rebuilt.
+        void request(const std::string& source, bool external, std::shared_ptr<const Level> previous = nullptr);
+        std::shared_ptr<Level> poll();
+        // Key of the latest request if it failed to load, once; empty
+        // otherwise. Load() has already said why.
+        std::string pollFailure();
+        bool busy() const;
+
+    private:
+        struct Request
+        {
+            std::string source;
+            bool external;
+            std::shared_ptr<const Level> previous;
+            uint64_t generation;
+        };
+
+        void run();
+
+        const sf::Vector2f wsize;
+        const Colorset colorset;
+        ThreadPool pool;                                // geometry baking
+
+        mutable std::mutex mutex;
+        std::condition_variable wake;
+        std::optional<Request> pending;
+        std::shared_ptr<Level> finished;
+        std::string failed;
+        uint64_t latest = 0;
+        bool working = false;
+        bool stopping = false;
+        std::thread worker;
+};
+
+}
@@ -0,0 +1,25 @@
+#pragma once
+#include <cstddef>
+
+namespace cb {
+
+enum class Lod
+{
+    Full,       // every ring and the glow
+    Reduced,    // a couple of rings, no glow
+    Flat,       // single filled shape
+    Point       // a few pixels wide at most
+};
+
+constexpr std::size_t lodCount = 4;
+
+// Tier for a feature covering `pixels` on screen.
+constexpr Lod selectLod(float pixels)
+{
+    if (pixels >= 24.0f) return Lod::Full;
+    if (pixels >= 10.0f) return Lod::Reduced;
+    if (pixels >= 3.0f)  return Lod::Flat;
+    return Lod::Point;
+}
+
+}
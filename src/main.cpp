@@ -1,21 +1,160 @@
 
 #include <SFML/Graphics.hpp>
 #include <SFML/OpenGL.hpp>
+#include <algorithm>
+#include <atomic>
+#include <charconv>
+#include <cmath>
+#include <cstring>
+#include <fstream>
+#include <iomanip>
+#include <iostream>
+#include <optional>
+#include <thread>
 #include "board.hpp"
 #include "colours.hpp"
+#include "file_watcher.hpp"
 #include "levels.hpp"
+#include "profiler.hpp"
+#include "replay.hpp"
+#include "input.hpp"
+#include "renderer.hpp"
+#include "snapshot.hpp"
+
+namespace {
+
+void printDistribution(const char* title, std::vector<double>& samples)
+{
+    if (samples.empty()) return;
+    std::sort(samples.begin(), samples.end());
+    double total = 0.0;
+    for (double f : samples) total += f;
+    auto percentile = [&](double p) { return samples[static_cast<std::size_t>(p * (samples.size() - 1))]; };
+
+    std::cout << std::fixed << std::setprecision(3)
+              << title << " (" << samples.size() << " samples)\n"
+              << "  mean:   " << total / samples.size() << " ms\n"
+              << "  p50:    " << percentile(0.50) << " ms\n"
+              << "  p99:    " << percentile(0.99) << " ms\n"
+              << "  max:    " << samples.back() << " ms\n";
+}
+
+// The whole argument as a count, or nothing if any of it isn't a digit
+std::optional<std::size_t> parseCount(const char* text)
+{
+    const char* end = text + std::strlen(text);
+    std::size_t value = 0;
+    const auto [at, error] = std::from_chars(text, end, value);
+    if (error != std::errc{} || at != end) return std::nullopt;
+    return value;
+}
+
+}
 
 int main(int argc, char* argv[])
 {
-    std::cout << "Vendor:   " << glGetString(GL_VENDOR) << "\n";
-    std::cout << "Renderer: " << glGetString(GL_RENDERER) << "\n";
-    std::cout << "Version:  " << glGetString(GL_VERSION) << "\n";
+    std::string levelFile;
+    std::string traceFile;
+    std::string recordFile;
+    std::string replayFile;
+    bool headless = false;
+    bool threaded = false;
+    bool watch = false;
+    std::size_t cacheMegabytes = 64;
+    std::size_t textureMegabytes = 0;
+    for (int i = 1; i < argc; ++i)
+    {
+        const std::string arg{ argv[i] };
+        if (arg == "--trace" && i + 1 < argc) traceFile = argv[++i];
+        else if ((arg == "--cache-mb" || arg == "--texture-mb") && i + 1 < argc)
+        {
+            const std::optional<std::size_t> megabytes = parseCount(argv[++i]);
+            if (!megabytes)
+            {
+                std::cerr << arg << " needs a whole number of megabytes, not " << argv[i] << "\n";
+                return 1;
+            }
+            (arg == "--cache-mb" ? cacheMegabytes : textureMegabytes) = *megabytes;
+        }
+        else if (arg == "--record" && i + 1 < argc) recordFile = argv[++i];
+        else if (arg == "--replay" && i + 1 < argc) replayFile = argv[++i];
+        else if (arg == "--headless") headless = true;
+        else if (arg == "--threaded") threaded = true;
+        else if (arg == "--watch") watch = true;
+        else levelFile = arg;
+    }
+
+    // Level revisions don't go into the input log, so a log with them in
+    // wouldn't replay to the state it recorded
+    if (!recordFile.empty() && watch)
+    {
+        std::cerr << "--record can't be combined with --watch\n";
+        return 1;
+    }
 
     sf::Vector2f wsize { 600.0f, 600.0f };
+
+    std::vector<cb::InputEvent> script;
+    if (!replayFile.empty())
+    {
+        auto events = cb::readInputLog(replayFile);
+        if (!events) return 1;
+        script = std::move(*events);
+    }
+
+    if (headless)
+    {
+        if (replayFile.empty())
+        {
+            std::cerr << "--headless needs --replay <log>\n";
+            return 1;
+        }
+        const cb::ReplayResult result = cb::replayHeadless(script, wsize);
+        std::cout << "Events:   " << result.events << " (" << result.frames << " frames)\n"
+                  << "Time:     " << result.seconds << " s, "
+                  << (result.seconds > 0.0 ? result.events / result.seconds : 0.0) << " events/s\n"
+                  << "State:    " << std::hex << result.hash << std::dec << "\n";
+#ifdef CB_PROFILING
+        cb::profile::Profiler::instance().writeAllocations(std::cout);
+#endif
+        if (result.expected && *result.expected != result.hash)
+        {
+            std::cerr << "Final state differs from recording: " << std::hex << *result.expected << std::dec << "\n";
+            return 2;
+        }
+        return 0;
+    }
+
+    // Cell glow is one shaded quad per node where the GPU allows it, rings
+    // of geometry otherwise
+    cb::Honeycomb::setShaderGlow(sf::Shader::isAvailable());
+
     cb::Board board(wsize);
-    if(argc > 1)
+    board.setCacheBudget(cacheMegabytes << 20);
+    board.setMemoryBudget(textureMegabytes << 20);
+
+    sf::Clock clock;
+    cb::InputRecorder recorder;
+    auto now = [&]() { return clock.getElapsedTime().asMicroseconds(); };
+    auto record = [&](cb::InputEvent event) {
+        event.time = now();
+        recorder.record(event);
+    };
+
+    if (!recordFile.empty() && recorder.open(recordFile))
+    {
+        board.setLevelListener([&](const cb::Level& level) {
+            record(cb::InputEvent{ .type = cb::InputEvent::Level, .source = level.source, .external = level.external });
+        });
+    }
+
+    if (!script.empty())
+    {
+        board.setScripted(true);
+    }
+    else if(!levelFile.empty())
     {
-        board.loadLevel(argv[1], true);
+        board.loadLevel(levelFile, true);
     }
     else
     {
@@ -26,50 +165,309 @@ int main(int argc, char* argv[])
     settings.antiAliasingLevel = 8;
     sf::RenderWindow window(sf::VideoMode({ static_cast<unsigned>(wsize.x), static_cast<unsigned>(wsize.y) }), "Cupboards", sf::Style::Titlebar, sf::State::Windowed, settings);
     window.setFramerateLimit(144);
+    board.setWindowSize(sf::Vector2f{ window.getSize() });
+    record(cb::InputEvent{ .type = cb::InputEvent::Resize, .position = sf::Vector2f{ window.getSize() } });
 
-    sf::Clock clock;
+    std::cout << "Vendor:   " << glGetString(GL_VENDOR) << "\n";
+    std::cout << "Renderer: " << glGetString(GL_RENDERER) << "\n";
+    std::cout << "Version:  " << glGetString(GL_VERSION) << "\n";
 
-    while (window.isOpen())
+    // --watch: saving the level file revises it in place
+    std::optional<cb::FileWatcher> watcher;
+    if (watch && script.empty()) watcher.emplace();
+
+    // E toggles the level editor; Ctrl+S writes the edited level back to
+    // its file, or to level.txt for a built-in one
+    std::string editPath;
+    std::string status;                 // board status shown in the window title
+
+    std::atomic<bool> debug = false;
+    bool panning = false;
+    bool dragging = false;
+    sf::Vector2f panFrom;
+    std::size_t cursor = 0;
+    cb::InputQueue input;
+    std::vector<double> frameTimes;
+    std::vector<double> latencies;          // oldest input of a frame to display()
+    frameTimes.reserve(std::count_if(script.begin(), script.end(), [](const cb::InputEvent& e) { return e.type == cb::InputEvent::Frame; }));
+    latencies.reserve(1 << 16);
+    int64_t lastFrame = now();
+    clock.restart();
+
+    // --threaded: this thread polls input and simulates, publishing a
+    // snapshot whenever it has; the render thread owns the window's GL
+    // context and draws the latest one. Simulation ticks at the frame rate
+    // the single threaded loop runs at, so animations keep their speed.
+    //
+    // The board still uploads level geometry and bakes identicons here,
+    // through Board::update(). That relies on SFML giving this thread a
+    // context of its own that shares objects with the window's: buffers
+    // and textures are complete (SFML flushes after creating them) before
+    // a snapshot that references them is published, and nothing here
+    // touches the window's view or framebuffer.
+    constexpr int64_t tick = 1'000'000 / 144;
+    int64_t nextTick = 0;
+    cb::SnapshotExchange exchange;
+    std::atomic<bool> rendering = false;
+    std::thread renderer;
+    auto render = [&]() {
+        if (!window.setActive(true)) return;
+        cb::BoardRenderer painter(board.getColorset());
+        uint64_t shown = 0;
+        while (rendering)
+        {
+            const cb::BoardSnapshot& snapshot = exchange.acquire();
+            window.clear(hexColor(color::Material::Background));
+            painter.draw(window, snapshot, debug);
+            window.display();
+            CB_PROFILE_FRAME();
+
+            // Snapshots published between two frames are never shown and
+            // their input goes unsampled; the next one shown includes it.
+            const int64_t frameEnd = now();
+            if (!script.empty()) frameTimes.push_back((frameEnd - lastFrame) * 0.001);
+            if (snapshot.sequence != shown && snapshot.inputTime >= 0 && latencies.size() < latencies.capacity())
+                latencies.push_back((frameEnd - snapshot.inputTime) * 0.001);
+            shown = snapshot.sequence;
+            lastFrame = frameEnd;
+        }
+        (void)window.setActive(false);
+    };
+    auto close = [&]() {
+        if (renderer.joinable())
+        {
+            rendering = false;
+            renderer.join();
+            (void)window.setActive(true);
+        }
+        window.close();
+    };
+    if (threaded)
     {
-        sf::Vector2f mousePos = window.mapPixelToCoords(sf::Mouse::getPosition(window));
+        board.capture(exchange.back());
+        exchange.publish();
+        (void)window.setActive(false);
+        rendering = true;
+        renderer = std::thread(render);
+    }
+
+    // Keyboard commands, applied in order with the mouse input around them
+    auto pressKey = [&](const cb::InputAction& action) {
+        const sf::Keyboard::Key key = action.key;
+        if (key == sf::Keyboard::Key::H) board.toggleHints();
+        if (key == sf::Keyboard::Key::Right) board.stepLevel(+1);
+        if (key == sf::Keyboard::Key::Left) board.stepLevel(-1);
+        // Solution playback moves chips outside the input log, so not while recording
+        if (key == sf::Keyboard::Key::P && !recorder.isOpen()) board.playSolution(action.shift ? 10.0f : 1.0f);
+        // Nor editing, whose revisions the log doesn't hold either
+        if (key == sf::Keyboard::Key::E && !recorder.isOpen())
+        {
+            const cb::Level& level = board.getLevel();
+            if (!board.isEditing()) editPath = level.external ? level.source : "level.txt";
+            board.toggleEditing();
+        }
+        if (board.isEditing())
+        {
+            if (key == sf::Keyboard::Key::Delete || key == sf::Keyboard::Key::Backspace) board.edit(cb::Board::Edit::Remove);
+            if (key == sf::Keyboard::Key::S && !action.control) board.edit(cb::Board::Edit::ToggleStart);
+            if (key == sf::Keyboard::Key::T) board.edit(cb::Board::Edit::SetTarget);
+            if (key == sf::Keyboard::Key::S && action.control)
+            {
+                std::ofstream out(editPath);
+                out << board.editedSource();
+                std::cout << (out ? "Saved " : "Failed to save ") << editPath << "\n";
+            }
+        }
+    };
+
+    auto apply = [&](const cb::InputAction& action) {
+        switch (action.type)
+        {
+            case cb::InputAction::MouseDown:
+                if (board.isEditing()) { board.editPress(action.position, action.value != 0.0f); break; }
+                record(cb::InputEvent{ .type = cb::InputEvent::MouseDown, .position = action.position });
+                board.mouseDown(action.position);
+                break;
+            case cb::InputAction::MouseMove:
+                if (board.isEditing()) { board.editMove(action.position); break; }
+                if (!board.isDragging()) break;
+                record(cb::InputEvent{ .type = cb::InputEvent::MouseMove, .position = action.position });
+                board.mouseMove(action.position);
+                break;
+            case cb::InputAction::MouseUp:
+                if (board.isEditing()) { board.editRelease(); break; }
+                record(cb::InputEvent{ .type = cb::InputEvent::MouseUp });
+                board.mouseUp();
+                break;
+            case cb::InputAction::Pan:
+                record(cb::InputEvent{ .type = cb::InputEvent::Pan, .position = action.position });
+                board.pan(action.position);
+                break;
+            case cb::InputAction::Zoom:
+                record(cb::InputEvent{ .type = cb::InputEvent::Zoom, .position = action.position, .value = action.value });
+                board.zoom(action.position, action.value);
+                break;
+            case cb::InputAction::ResetView:
+                record(cb::InputEvent{ .type = cb::InputEvent::ResetView });
+                board.resetView();
+                break;
+            case cb::InputAction::Key:
+                pressKey(action);
+                break;
+        }
+    };
 
+    while (window.isOpen())
+    {
         while (const std::optional<sf::Event> event = window.pollEvent())
         {
+            const int64_t polled = now();
             if (event->is<sf::Event::Closed>())
             {
-                window.close();
+                close();
+            }
+            else if (const auto* e = event->getIf<sf::Event::Resized>())
+            {
+                if (script.empty())
+                {
+                    record(cb::InputEvent{ .type = cb::InputEvent::Resize, .position = sf::Vector2f{ e->size } });
+                    board.setWindowSize(sf::Vector2f{ e->size });
+                }
             }
-            else if (const auto* e = event->getIf<sf::Event::MouseButtonPressed>())
+            else if (const auto* e = event->getIf<sf::Event::KeyPressed>())
+            {
+                if (e->code == sf::Keyboard::Key::F3) debug = !debug;
+                if (e->code == sf::Keyboard::Key::H && !script.empty()) board.toggleHints();   // otherwise queued below
+            }
+            if (!script.empty()) continue;
+
+            if (const auto* e = event->getIf<sf::Event::MouseButtonPressed>())
             {
                 if (e->button == sf::Mouse::Button::Left)
                 {
-                    sf::Vector2f mousePos = window.mapPixelToCoords(sf::Mouse::getPosition(window));
-                    board.mouseDown(mousePos);
+                    dragging = true;
+                    const bool shift = sf::Keyboard::isKeyPressed(sf::Keyboard::Key::LShift) || sf::Keyboard::isKeyPressed(sf::Keyboard::Key::RShift);
+                    input.push({ cb::InputAction::MouseDown, sf::Vector2f(e->position), shift ? 1.0f : 0.0f, polled });
+                }
+                else if (e->button == sf::Mouse::Button::Right || e->button == sf::Mouse::Button::Middle)
+                {
+                    panning = true;
+                    panFrom = sf::Vector2f(e->position);
                 }
             }
             else if (const auto* e = event->getIf<sf::Event::MouseButtonReleased>())
             {
                 if (e->button == sf::Mouse::Button::Left)
                 {
-                    board.mouseUp();
+                    dragging = false;
+                    input.push({ cb::InputAction::MouseUp, {}, 0.0f, polled });
+                }
+                else if (e->button == sf::Mouse::Button::Right || e->button == sf::Mouse::Button::Middle)
+                {
+                    panning = false;
                 }
             }
-            else if (event->is<sf::Event::MouseMoved>())
+            else if (const auto* e = event->getIf<sf::Event::MouseWheelScrolled>())
+            {
+                if (e->wheel == sf::Mouse::Wheel::Vertical)
+                    input.push({ cb::InputAction::Zoom, sf::Vector2f(e->position), std::pow(0.9f, e->delta), polled });
+            }
+            else if (const auto* e = event->getIf<sf::Event::KeyPressed>())
+            {
+                if (e->code == sf::Keyboard::Key::Home) input.push({ cb::InputAction::ResetView, {}, 0.0f, polled });
+                else input.push({ cb::InputAction::Key, {}, 0.0f, polled, e->code, e->shift, e->control });
+            }
+            else if (const auto* e = event->getIf<sf::Event::MouseMoved>())
             {
-                if (board.isDragging())
+                const sf::Vector2f to = sf::Vector2f(e->position);
+                if (panning)
                 {
-                    sf::Vector2f mousePos = window.mapPixelToCoords(sf::Mouse::getPosition(window));
-                    board.mouseMove(mousePos);
+                    input.push({ cb::InputAction::Pan, to - panFrom, 0.0f, polled });
+                    panFrom = to;
                 }
+                if (dragging) input.push({ cb::InputAction::MouseMove, to, 0.0f, polled });
             }
         }
 
-	    sf::Vector2f mp = window.mapPixelToCoords(sf::Mouse::getPosition(window));
-        window.clear(hexColor(color::Material::Background));
+        if (std::string now = board.status(); now != status)
+        {
+            status = std::move(now);
+            window.setTitle(status.empty() ? "Cupboards" : "Cupboards - " + status);
+        }
 
-	    float scale = 48.0f/240.0f;
-        board.draw(window, scale, false, mp);
+        if (watcher)
+        {
+            const cb::Level& level = board.getLevel();
+            watcher->watch(level.external ? level.source : std::string{});
+            if (watcher->changed()) board.reviseLevel();
+        }
+
+        int64_t inputTime = -1;
+        if (!script.empty())
+        {
+            // Real-time replay: the log's own frames drive the simulation
+            const int64_t t = now();
+            while (cursor < script.size() && script[cursor].time <= t)
+                cb::applyInput(board, script[cursor++]);
+            if (cursor == script.size()) close();
+        }
+        else if (threaded)
+        {
+            inputTime = input.oldest();
+            input.drain(apply);
+            const int64_t t = now();
+            if (nextTick < t - 8 * tick) nextTick = t;     // don't race to catch up after a stall
+            for (; nextTick <= t; nextTick += tick)
+            {
+                record(cb::InputEvent{ .type = cb::InputEvent::Frame, .value = 0.02f });
+                board.update(0.02f);
+            }
+        }
+        else
+        {
+            inputTime = input.oldest();
+            input.drain(apply);
+            record(cb::InputEvent{ .type = cb::InputEvent::Frame, .value = 0.02f });
+            board.update(0.02f);
+        }
+
+        if (threaded)
+        {
+            if (!window.isOpen()) break;
+            cb::BoardSnapshot& snapshot = exchange.back();
+            board.capture(snapshot);
+            snapshot.inputTime = inputTime;
+            exchange.publish();
+            sf::sleep(sf::milliseconds(1));
+            continue;
+        }
+
+        window.clear(hexColor(color::Material::Background));
+        board.draw(window, debug);
         window.display();
+        CB_PROFILE_FRAME();
+
+        const int64_t frameEnd = now();
+        if (!script.empty()) frameTimes.push_back((frameEnd - lastFrame) * 0.001);
+        if (inputTime >= 0 && latencies.size() < latencies.capacity()) latencies.push_back((frameEnd - inputTime) * 0.001);
+        lastFrame = frameEnd;
     }
-}
 
+    recorder.close(board.getPuzzle().hash());
+    if (!script.empty())
+    {
+        std::cout << "State:    " << std::hex << board.getPuzzle().hash() << std::dec << "\n";
+        printDistribution("Frame time", frameTimes);
+    }
+    if (!latencies.empty())
+    {
+        std::cout << "Input:    " << input.getReceived() << " events, " << input.getApplied() << " applied after coalescing\n";
+        printDistribution("Input to display()", latencies);
+    }
+
+#ifdef CB_PROFILING
+    cb::profile::Profiler::instance().writeAllocations(std::cout);
+    if (!traceFile.empty())
+        cb::profile::Profiler::instance().writeTrace(traceFile);
+#endif
+}
@@ -0,0 +1,188 @@
+#pragma once
+#include <SFML/Graphics.hpp>
+#include <algorithm>
+#include <cstdint>
+#include <cstring>
+#include <memory>
+#include <unordered_set>
+#include <vector>
+#include "core/thread_pool.hpp"
+
+namespace cb {
+
+// Every item of one kind of geometry at one Lod, in world coordinates,
+// stored in pages of consecutive items with one vertex array each. build()
+// is the CPU stage: it sizes each item, allocates a page at a time and has
+// the pool fill pages in parallel. upload() is the GL stage, one copy per
+// page into a vertex buffer. A run of consecutive items is one draw call
+// per page it spans.
+//
+// Pages never change once built, so a new version of the geometry shares
+// the pages its edits don't touch with the old one, which may still be on
+// screen, and rebuilds (and re-uploads) only the rest.
+class MeshBatch
+{
+    public:
+        // reuse, when given, maps each item to an identical item of
+        // previous, or -1: mapped items are copied instead of regenerated,
+        // and a page whose items all map to themselves is shared outright.
+        template<class Count, class Write>
+        void build(sf::PrimitiveType primitive, std::size_t items, Count&& count, Write&& write, ThreadPool* pool = nullptr,
+                   const MeshBatch* previous = nullptr, const std::vector<int32_t>* reuse = nullptr)
+        {
+            type = primitive;
+            total = items;
+            pages.assign((items + pageItems - 1) / pageItems, nullptr);
+            if (!reuse) previous = nullptr;
+
+            std::vector<std::size_t> pending;
+            for (std::size_t p = 0; p < pages.size(); ++p)
+            {
+                if (previous && previous->sharesPage(p, items, *reuse)) pages[p] = previous->pages[p];
+                else pending.push_back(p);
+            }
+
+            auto fill = [&](std::size_t at) {
+                const std::size_t p = pending[at];
+                const std::size_t begin = p * pageItems;
+                const std::size_t end = std::min(items, begin + pageItems);
+
+                auto page = std::make_shared<Page>();
+                page->first.assign(end - begin + 1, 0);
+                for (std::size_t i = begin; i < end; ++i)
+                {
+                    const int32_t from = previous ? (*reuse)[i] : -1;
+                    const std::size_t size = from >= 0 ? previous->vertexCount(static_cast<std::size_t>(from)) : count(i);
+                    page->first[i - begin + 1] = page->first[i - begin] + static_cast<uint32_t>(size);
+                }
+
+                page->vertices.resize(page->first.back());
+                for (std::size_t i = begin; i < end; ++i)
+                {
+                    sf::Vertex* out = page->vertices.data() + page->first[i - begin];
+                    const int32_t from = previous ? (*reuse)[i] : -1;
+                    if (from >= 0) previous->copyItem(static_cast<std::size_t>(from), out);
+                    else write(i, out);
+                }
+                pages[p] = std::move(page);
+            };
+            if (pool && pending.size() > 1) pool->parallelFor(pending.size(), fill);
+            else for (std::size_t at = 0; at < pending.size(); ++at) fill(at);
+        }
+
+        // Uploads pages not yet on the GPU. False where vertex buffers
+        // aren't supported; draw() then sends the CPU copy each time.
+        bool upload()
+        {
+            if (!sf::VertexBuffer::isAvailable()) return false;
+            bool all = true;
+            for (const std::shared_ptr<Page>& page : pages)
+            {
+                if (page->uploaded || page->vertices.empty()) continue;
+                page->buffer = sf::VertexBuffer{ type, sf::VertexBuffer::Usage::Static };
+                page->uploaded = page->buffer.create(page->vertices.size()) && page->buffer.update(page->vertices.data());
+                all = all && page->uploaded;
+            }
+            return all;
+        }
+
+        void draw(sf::RenderTarget& target, std::size_t item, std::size_t count = 1, const sf::RenderStates& states = sf::RenderStates::Default) const
+        {
+            while (count > 0)
+            {
+                const Page& page = *pages[item / pageItems];
+                const std::size_t local = item % pageItems;
+                const std::size_t span = std::min(count, pageItems - local);
+                const std::size_t begin = page.first[local];
+                const std::size_t size = page.first[local + span] - begin;
+                if (size > 0)
+                {
+                    if (page.uploaded) target.draw(page.buffer, begin, size, states);
+                    else target.draw(page.vertices.data() + begin, size, type, states);
+                }
+                item += span;
+                count -= span;
+            }
+        }
+
+        std::size_t items() const { return total; }
+
+        std::size_t vertexCount() const
+        {
+            std::size_t vertices = 0;
+            for (const std::shared_ptr<Page>& page : pages) vertices += page->vertices.size();
+            return vertices;
+        }
+
+        std::size_t vertexCount(std::size_t item, std::size_t count = 1) const
+        {
+            std::size_t vertices = 0;
+            while (count > 0)
+            {
+                const Page& page = *pages[item / pageItems];
+                const std::size_t local = item % pageItems;
+                const std::size_t span = std::min(count, pageItems - local);
+                vertices += page.first[local + span] - page.first[local];
+                item += span;
+                count -= span;
+            }
+            return vertices;
+        }
+
+        std::size_t memoryBytes() const
+        {
+            std::size_t bytes = pages.capacity() * sizeof(pages[0]);
+            for (const std::shared_ptr<Page>& page : pages)
+                bytes += sizeof(Page) + page->vertices.capacity() * sizeof(sf::Vertex) + page->first.capacity() * sizeof(uint32_t);
+            return bytes;
+        }
+
+        // Vertex buffer memory of uploaded pages not already in seen, which
+        // collects pages so ones shared between batches count once.
+        std::size_t bufferBytes(std::unordered_set<const void*>& seen) const
+        {
+            std::size_t bytes = 0;
+            for (const std::shared_ptr<Page>& page : pages)
+            {
+                if (page->uploaded && seen.insert(page.get()).second) bytes += page->vertices.size() * sizeof(sf::Vertex);
+            }
+            return bytes;
+        }
+
+        static constexpr std::size_t pageItems = 256;
+
+    private:
+        struct Page
+        {
+            std::vector<sf::Vertex> vertices;
+            std::vector<uint32_t> first;            // per item of the page, plus the end
+            sf::VertexBuffer buffer;
+            bool uploaded = false;
+        };
+
+        bool sharesPage(std::size_t p, std::size_t items, const std::vector<int32_t>& reuse) const
+        {
+            const std::size_t begin = p * pageItems;
+            const std::size_t end = std::min(items, begin + pageItems);
+            if (p >= pages.size() || end > total || (end - begin) != std::min(total - begin, pageItems)) return false;
+            for (std::size_t i = begin; i < end; ++i)
+            {
+                if (reuse[i] != static_cast<int32_t>(i)) return false;
+            }
+            return true;
+        }
+
+        void copyItem(std::size_t item, sf::Vertex* out) const
+        {
+            const Page& page = *pages[item / pageItems];
+            const std::size_t local = item % pageItems;
+            const std::size_t begin = page.first[local];
+            std::memcpy(static_cast<void*>(out), page.vertices.data() + begin, (page.first[local + 1] - begin) * sizeof(sf::Vertex));
+        }
+
+        sf::PrimitiveType type = sf::PrimitiveType::Lines;
+        std::size_t total = 0;
+        std::vector<std::shared_ptr<Page>> pages;
+};
+
+}
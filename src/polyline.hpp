@@ -2,67 +2,85 @@
 #include <SFML/Graphics.hpp>
 #include <cstdint>
 #include <vector>
+#include <array>
 #include <cmath>
 #include "utility.hpp"
+#include "lod.hpp"
 
 
 namespace cb {
 
-class PolyLine : public sf::Drawable
+// A connection between two nodes. At full detail it is one quad whose
+// colour runs outer, inner, outer across its width: the quad's texture
+// coordinates span the three texels of gradient(), which linear filtering
+// turns into the ramps, so it looks the same solid band at any zoom. The
+// quad is drawn with that texture bound. Joins need no mitring, since both
+// ends lie under the node cells drawn over them.
+class PolyLine
 {
 public:
     PolyLine(
         const sf::Vector2f& start,
         const sf::Vector2f& end,
-        int thickness,
-        int step,
-        sf::Color colorInner = sf::Color::White,
-        sf::Color colorOuter = sf::Color::Blue)
-        : colorInner(colorInner), colorOuter(colorOuter), width(thickness)
+        float thickness,
+        sf::Color colorInner = sf::Color::White)
+        : start(start), end(end), colorInner(colorInner), width(thickness)
     {
-        generate(start, end, step);
+    }
+
+    // The texture full detail quads are drawn with, smoothed.
+    static sf::Image gradient(sf::Color inner, sf::Color outer)
+    {
+        sf::Image image({ 3, 1 }, outer);
+        image.setPixel({ 1, 0 }, inner);
+        return image;
+    }
+
+    // How many vertices, then the vertices themselves, for callers
+    // building one buffer out of many lines.
+    std::size_t countVertices(Lod lod) const
+    {
+        if (lod != Lod::Full) return 2;
+        return start == end ? 0 : 6;
+    }
+
+    sf::Vertex* writeVertices(Lod lod, sf::Vertex* out) const
+    {
+        auto append = [&](const sf::Vertex& v) { *out++ = v; };
+        if (lod == Lod::Full) generate(append);
+        else                  generateCentre(append);
+        return out;
     }
 
 private:
-    sf::VertexArray vertices{ sf::PrimitiveType::TriangleStrip };
-    sf::Color colorInner;
-    sf::Color colorOuter;
+    sf::Vector2f start;
+    sf::Vector2f end;
+    sf::Color colorInner;                               // centre line
     float width;
 
-    void generate(const sf::Vector2f& start, const sf::Vector2f& end, int step)
+    template<class Append>
+    void generate(Append&& append) const
     {
         sf::Vector2f direction = end - start;
         float length = std::sqrt(direction.x * direction.x + direction.y * direction.y);
         if (length == 0.f) return;
 
-        sf::Vector2f unitDir = direction / length;
-        sf::Vector2f normal(-unitDir.y, unitDir.x);
-
-        int numLines = static_cast<int>(width / step);
-        float halfWidth = step * numLines / 2.f;
-
-        vertices.clear();
-        vertices.setPrimitiveType(sf::PrimitiveType::Lines);
-
-        for (int i = 0; i <= numLines; ++i)
-        {
-            float offset = -halfWidth + i * step;
-            sf::Vector2f shift = normal * offset;
-
-            sf::Vector2f p1 = start + shift;
-            sf::Vector2f p2 = end + shift;
-
-            float t = std::abs(offset) / halfWidth;
-            sf::Color color = lerpColor(colorInner, colorOuter, t);
+        const sf::Vector2f unitDir = direction / length;
+        const sf::Vector2f shift = sf::Vector2f(-unitDir.y, unitDir.x) * (width * 0.5f);
 
-            vertices.append(sf::Vertex{ p1, color });
-            vertices.append(sf::Vertex{ p2, color });
-        }    
+        // Texel centres of the outer, inner and outer colours
+        const sf::Vertex a{ start - shift, sf::Color::White, { 0.5f, 0.5f } };
+        const sf::Vertex b{ end - shift, sf::Color::White, { 0.5f, 0.5f } };
+        const sf::Vertex c{ end + shift, sf::Color::White, { 2.5f, 0.5f } };
+        const sf::Vertex d{ start + shift, sf::Color::White, { 2.5f, 0.5f } };
+        for (const sf::Vertex& v : { a, b, c, a, c, d }) append(v);
     }
 
-    void draw(sf::RenderTarget& target, sf::RenderStates states) const override
+    template<class Append>
+    void generateCentre(Append&& append) const
     {
-        target.draw(vertices, states);
+        append(sf::Vertex{ start, colorInner });
+        append(sf::Vertex{ end, colorInner });
     }
 };
 }
@@ -0,0 +1,198 @@
+#include "profiler.hpp"
+#include <algorithm>
+#include <atomic>
+#include <cstring>
+#include <fstream>
+#include <iomanip>
+#include <iostream>
+
+namespace cb::profile {
+
+namespace {
+
+uint32_t threadIndex()
+{
+    static std::atomic<uint32_t> next{ 0 };
+    thread_local const uint32_t index = next++;
+    return index;
+}
+
+// Names are literals, usually one per call site, but the same literal in
+// two translation units needn't share an address
+bool sameName(const char* a, const char* b)
+{
+    return a == b || std::strcmp(a, b) == 0;
+}
+
+}
+
+Profiler& Profiler::instance()
+{
+    static Profiler profiler;
+    return profiler;
+}
+
+Profiler::Profiler(): epoch(std::chrono::steady_clock::now())
+{
+    events.reserve(4096);
+}
+
+int64_t Profiler::now() const
+{
+    const auto elapsed = std::chrono::steady_clock::now() - epoch;
+    return std::chrono::duration_cast<std::chrono::microseconds>(elapsed).count();
+}
+
+void Profiler::record(const char* name, int64_t start, int64_t duration)
+{
+    const uint32_t thread = threadIndex();
+    const Untracked untracked;
+    std::lock_guard lock(mutex);
+
+    if (events.size() < maxEvents)
+        events.push_back(Event{ name, start, duration, thread });
+
+    for (Accumulator& phase : phases)
+    {
+        if (sameName(phase.name, name))
+        {
+            phase.current += duration;
+            return;
+        }
+    }
+    phases.push_back(Accumulator{ name, duration, 0.0 });
+}
+
+void Profiler::countDraw(std::size_t count)
+{
+    std::lock_guard lock(mutex);
+    ++drawCalls;
+    vertices += count;
+}
+
+void Profiler::endFrame()
+{
+    constexpr double smoothing = 0.1;
+    const int64_t timestamp = now();
+    const uint64_t allocations = threadAllocations().count;
+    const bool firstFrame = frameStart == 0;
+    const uint64_t frameAllocations = allocations - frameAllocationMark;
+
+    const Untracked untracked;
+    if (!firstFrame) recordAllocations("frame", frameAllocations);
+
+    std::lock_guard lock(mutex);
+    for (Accumulator& phase : phases)
+    {
+        phase.average += (phase.current * 0.001 - phase.average) * smoothing;
+        phase.current = 0;
+    }
+
+    if (frameStart != 0)
+        frameAverage += ((timestamp - frameStart) * 0.001 - frameAverage) * smoothing;
+    frameStart = timestamp;
+
+    if (counters.size() < maxEvents)
+        counters.push_back(Counter{ timestamp, drawCalls, vertices, frameAllocations });
+
+    lastAllocations = frameAllocations;
+    frameAllocationMark = threadAllocations().count;
+    lastDrawCalls = drawCalls;
+    lastVertices = vertices;
+    drawCalls = 0;
+    vertices = 0;
+}
+
+FrameStats Profiler::stats() const
+{
+    std::lock_guard lock(mutex);
+    FrameStats result;
+    result.allocations = lastAllocations;
+    result.phases.reserve(phases.size());
+    for (const Accumulator& phase : phases)
+        result.phases.push_back(Phase{ phase.name, phase.average });
+
+    result.frameMilliseconds = frameAverage;
+    result.drawCalls = lastDrawCalls;
+    result.vertices = lastVertices;
+    return result;
+}
+
+void Profiler::recordAllocations(const char* name, uint64_t count)
+{
+    std::lock_guard lock(mutex);
+    AllocationStats* slot = nullptr;
+    for (std::size_t i = 0; i < allocationSlots; ++i)
+    {
+        if (sameName(allocationStats[i].name, name)) slot = &allocationStats[i];
+    }
+    if (slot == nullptr)
+    {
+        if (allocationSlots == allocationStats.size()) return;
+        slot = &allocationStats[allocationSlots++];
+        slot->name = name;
+    }
+
+    ++slot->samples;
+    slot->allocating += count != 0;
+    slot->total += count;
+    slot->peak = std::max(slot->peak, count);
+}
+
+void Profiler::writeAllocations(std::ostream& out) const
+{
+    std::lock_guard lock(mutex);
+    out << std::left << std::setw(16) << "allocations" << std::right
+        << std::setw(10) << "samples" << std::setw(12) << "allocating"
+        << std::setw(10) << "mean" << std::setw(8) << "peak" << "\n";
+    for (std::size_t i = 0; i < allocationSlots; ++i)
+    {
+        const AllocationStats& s = allocationStats[i];
+        out << std::left << std::setw(16) << s.name << std::right
+            << std::setw(10) << s.samples << std::setw(12) << s.allocating
+            << std::setw(10) << std::fixed << std::setprecision(2) << (s.samples ? double(s.total) / s.samples : 0.0)
+            << std::setw(8) << s.peak << "\n";
+    }
+}
+
+// Chrome trace_event format, open with chrome://tracing or ui.perfetto.dev
+bool Profiler::writeTrace(const std::string& filename) const
+{
+    std::ofstream file(filename);
+    if (!file.is_open())
+    {
+        std::cerr << "Failed to write trace: " << filename << "\n";
+        return false;
+    }
+
+    std::lock_guard lock(mutex);
+    file << "{\"displayTimeUnit\":\"ms\",\"traceEvents\":[\n";
+
+    bool first = true;
+    auto separator = [&]() -> std::ofstream& {
+        if (!first) file << ",\n";
+        first = false;
+        return file;
+    };
+
+    for (const Event& event : events)
+    {
+        separator() << "{\"name\":\"" << event.name
+                    << "\",\"cat\":\"cupboards\",\"ph\":\"X\",\"pid\":1,\"tid\":" << event.thread
+                    << ",\"ts\":" << event.start
+                    << ",\"dur\":" << event.duration << "}";
+    }
+
+    for (const Counter& counter : counters)
+    {
+        separator() << "{\"name\":\"frame\",\"ph\":\"C\",\"pid\":1,\"tid\":0,\"ts\":" << counter.timestamp
+                    << ",\"args\":{\"drawCalls\":" << counter.drawCalls
+                    << ",\"vertices\":" << counter.vertices
+                    << ",\"allocations\":" << counter.allocations << "}}";
+    }
+
+    file << "\n]}\n";
+    return true;
+}
+
+}
@@ -0,0 +1,163 @@
+#pragma once
+#include <cstdint>
+#include <cstddef>
+#include <chrono>
+#include <array>
+#include <mutex>
+#include <ostream>
+#include <string>
+#include <vector>
+
+// Scoped timers, draw and heap allocation counters. Everything below is
+// compiled out unless CB_PROFILING is defined (cmake -DCUPBOARDS_PROFILING=ON).
+
+#define CB_CONCAT_IMPL(a, b) a##b
+#define CB_CONCAT(a, b) CB_CONCAT_IMPL(a, b)
+
+#ifdef CB_PROFILING
+    #define CB_PROFILE_SCOPE(name) ::cb::profile::Scope CB_CONCAT(cbProfileScope, __LINE__){ name }
+    #define CB_PROFILE_DRAW(vertices) ::cb::profile::Profiler::instance().countDraw(vertices)
+    #define CB_PROFILE_FRAME() ::cb::profile::Profiler::instance().endFrame()
+    #define CB_PROFILE_ALLOCATIONS(name) ::cb::profile::AllocationScope CB_CONCAT(cbAllocationScope, __LINE__){ name }
+#else
+    #define CB_PROFILE_SCOPE(name) ((void)0)
+    #define CB_PROFILE_DRAW(vertices) ((void)0)
+    #define CB_PROFILE_FRAME() ((void)0)
+    #define CB_PROFILE_ALLOCATIONS(name) ((void)0)
+#endif
+
+namespace cb::profile {
+
+struct Event
+{
+    const char* name;       // string literal, never owned
+    int64_t start;          // microseconds since profiler start
+    int64_t duration;       // microseconds
+    uint32_t thread;
+};
+
+struct Phase
+{
+    const char* name;
+    double milliseconds;    // smoothed over recent frames
+};
+
+// Heap allocations made so far by the calling thread. Counted by the
+// global operator new in allocations.cpp, which only counts in profiling
+// builds; elsewhere this stays zero.
+struct AllocationCount
+{
+    uint64_t count = 0;
+    uint64_t bytes = 0;
+};
+
+AllocationCount threadAllocations();
+
+// Allocations made by the profiler's own bookkeeping aren't charged to the
+// code being measured.
+class Untracked
+{
+    public:
+        Untracked();
+        ~Untracked();
+        Untracked(const Untracked&) = delete;
+        Untracked& operator=(const Untracked&) = delete;
+};
+
+struct AllocationStats
+{
+    const char* name;
+    uint64_t samples = 0;       // frames or calls measured
+    uint64_t allocating = 0;    // samples that allocated at all
+    uint64_t total = 0;
+    uint64_t peak = 0;
+};
+
+struct FrameStats
+{
+    std::vector<Phase> phases;
+    double frameMilliseconds = 0.0;
+    std::size_t drawCalls = 0;
+    std::size_t vertices = 0;
+    uint64_t allocations = 0;
+};
+
+class Profiler
+{
+    public:
+        static Profiler& instance();
+
+        int64_t now() const;
+        void record(const char*, int64_t, int64_t);
+        void countDraw(std::size_t vertices);
+        void endFrame();
+        void recordAllocations(const char*, uint64_t count);
+
+        FrameStats stats() const;
+        bool writeTrace(const std::string&) const;
+        void writeAllocations(std::ostream&) const;
+
+        static constexpr std::size_t maxEvents = 1 << 20;
+
+    private:
+        Profiler();
+
+        struct Accumulator
+        {
+            const char* name;
+            int64_t current = 0;
+            double average = 0.0;
+        };
+
+        struct Counter
+        {
+            int64_t timestamp;
+            std::size_t drawCalls;
+            std::size_t vertices;
+            uint64_t allocations;
+        };
+
+        const std::chrono::steady_clock::time_point epoch;
+        mutable std::mutex mutex;
+        std::vector<Event> events;
+        std::vector<Counter> counters;
+        std::vector<Accumulator> phases;
+        int64_t frameStart = 0;
+        double frameAverage = 0.0;
+        std::size_t drawCalls = 0;
+        std::size_t vertices = 0;
+        std::size_t lastDrawCalls = 0;
+        std::size_t lastVertices = 0;
+        uint64_t frameAllocationMark = 0;
+        uint64_t lastAllocations = 0;
+        std::array<AllocationStats, 32> allocationStats{};    // fixed, so recording never allocates
+        std::size_t allocationSlots = 0;
+};
+
+class Scope
+{
+    public:
+        explicit Scope(const char* name): name(name), start(Profiler::instance().now()) {}
+        ~Scope() { Profiler::instance().record(name, start, Profiler::instance().now() - start); }
+        Scope(const Scope&) = delete;
+        Scope& operator=(const Scope&) = delete;
+
+    private:
+        const char* name;
+        int64_t start;
+};
+
+class AllocationScope
+{
+    public:
+        explicit AllocationScope(const char* name): name(name), start(threadAllocations().count) {}
+        ~AllocationScope() { Profiler::instance().recordAllocations(name, threadAllocations().count - start); }
+        AllocationScope(const AllocationScope&) = delete;
+        AllocationScope& operator=(const AllocationScope&) = delete;
+
+    private:
+        const char* name;
+        uint64_t start;
+};
+
+}
@@ -0,0 +1,393 @@
+#include "renderer.hpp"
+#include <algorithm>
+#include <cmath>
+#include <iostream>
+#include <iomanip>
+#include <sstream>
+#include "colours.hpp"
+#include "animation.hpp"
+#include "glow.hpp"
+#include "profiler.hpp"
+
+namespace cb {
+
+namespace {
+
+// Calls draw(first, count) once per run of consecutive item indices with
+// the same key, so neighbouring items in a batch go out in one draw call.
+template<class Key, class Draw>
+void forEachRun(const std::vector<uint32_t>& sorted, Key&& key, Draw&& draw)
+{
+    for (std::size_t i = 0; i < sorted.size();)
+    {
+        const uint32_t first = sorted[i];
+        const auto runKey = key(first);
+        std::size_t count = 1;
+        while (i + count < sorted.size() && sorted[i + count] == first + count && key(sorted[i + count]) == runKey) ++count;
+        draw(first, count);
+        i += count;
+    }
+}
+
+}
+
+BoardRenderer::BoardRenderer(const Colorset& colorset, bool headless)
+    : colorset(colorset)
+{
+#ifdef CB_PROFILING
+    if (!headless && !uiFont.openFromFile(CB_ASSET_DIR "/JetBrainsMonoNerdFontMono-Regular.ttf"))
+        std::cerr << "Failed to load UI font, profiler overlay disabled\n";
+#else
+    (void)headless;
+#endif
+    if (!headless)
+    {
+        if (connectionGradient.loadFromImage(PolyLine::gradient(colorset.foreground, colorset.background)))
+            connectionGradient.setSmooth(true);
+        hexGlow = loadGlowShader(hexGlowSource);
+    }
+
+    suggestionRing.setOrigin({ suggestionRadius, suggestionRadius });
+    suggestionRing.setFillColor(sf::Color::Transparent);
+    suggestionRing.setOutlineThickness(2.0f);
+    selectionRing.setOrigin({ selectionRadius, selectionRadius });
+    selectionRing.setFillColor(sf::Color::Transparent);
+}
+
+void BoardRenderer::draw(sf::RenderTarget& target, const BoardSnapshot& frame, bool debug)
+{
+    CB_PROFILE_SCOPE("draw");
+    CB_PROFILE_ALLOCATIONS("draw");
+    if (!frame.level) return;
+
+    const sf::View uiView = target.getView();
+    target.setView(frame.view);
+    const sf::Vector2f size = frame.view.getSize();
+    const sf::FloatRect area{ frame.view.getCenter() - size * 0.5f, size };
+
+    drawConnections(target, frame, area);
+    drawHoneycombs(target, frame, area);
+    drawPath(target, frame);
+
+    const sf::Vector2f margin{ cullMargin, cullMargin };
+    visible.clear();
+    frame.level->honeycombGrid.query(sf::FloatRect{ area.position - margin, area.size + margin * 2.0f }, visible);
+    drawHints(target, frame);
+    drawSuggestion(target, frame);
+    drawChips(target, frame);
+    drawMotions(target, frame);
+    drawDraggedChip(target, frame);
+    drawSelection(target, frame);
+
+    target.setView(uiView);
+    drawButtons(target, frame);
+    drawEditStatus(target, frame);
+
+    if (debug) drawProfiler(target, frame);
+}
+
+void BoardRenderer::drawConnections(sf::RenderTarget& target, const BoardSnapshot& frame, const sf::FloatRect& area)
+{
+    CB_PROFILE_SCOPE("connections");
+    const Level& level = *frame.level;
+    const Lod lod = selectLod(48.0f / frame.zoom);  // follow the intersection cells
+    level.prepareLod(lod);
+    const MeshBatch& mesh = level.meshes->connectionMeshes[lod == Lod::Full ? 0 : 1];
+    const sf::RenderStates states{ lod == Lod::Full ? &connectionGradient : nullptr };
+    visible.clear();
+    level.connectionGrid.query(area, visible);
+    std::sort(visible.begin(), visible.end());
+    forEachRun(visible, [](uint32_t) { return 0; }, [&](std::size_t first, std::size_t count) {
+        mesh.draw(target, first, count, states);
+        CB_PROFILE_DRAW(mesh.vertexCount(first, count));
+    });
+}
+
+void BoardRenderer::drawHoneycombs(sf::RenderTarget& target, const BoardSnapshot& frame, const sf::FloatRect& area)
+{
+    CB_PROFILE_SCOPE("honeycombs");
+    const Level& level = *frame.level;
+    visible.clear();
+    level.honeycombGrid.query(area, visible);
+    std::sort(visible.begin(), visible.end());
+    auto lodOf = [&](uint32_t index) { return selectLod(level.bakedHoneycombs[index].getSize().x / frame.zoom); };
+
+    const LevelMeshes& meshes = *level.meshes;
+    const bool glow = hexGlow && meshes.honeycombGlow.items() > 0;
+    sf::RenderStates glowStates;
+    if (glow)
+    {
+        hexGlow->setUniform("width", std::min(glowWidth, Honeycomb::glowReach));
+        hexGlow->setUniform("intensity", glowIntensity);
+        glowStates.shader = hexGlow.get();
+    }
+
+    forEachRun(visible, lodOf, [&](std::size_t first, std::size_t count) {
+        const Lod lod = lodOf(static_cast<uint32_t>(first));
+        const std::size_t tier = static_cast<std::size_t>(lod);
+        level.prepareLod(lod);
+        meshes.honeycombFill[tier].draw(target, first, count);
+        meshes.honeycombWire[tier].draw(target, first, count);
+        CB_PROFILE_DRAW(meshes.honeycombFill[tier].vertexCount(first, count) + meshes.honeycombWire[tier].vertexCount(first, count));
+        if (glow && tier == static_cast<std::size_t>(Lod::Full))
+        {
+            meshes.honeycombGlow.draw(target, first, count, glowStates);
+            CB_PROFILE_DRAW(meshes.honeycombGlow.vertexCount(first, count));
+        }
+    });
+}
+
+void BoardRenderer::drawPath(sf::RenderTarget& target, const BoardSnapshot& frame)
+{
+    const DragState& drag = frame.drag;
+    if (!drag.active || drag.path.empty()) return;
+    CB_PROFILE_SCOPE("path");
+
+    pathLine.resize(drag.path.size());
+    for (size_t i = 0; i < drag.path.size(); ++i)
+    {
+        const Node* it = frame.level->puzzle.findNode(drag.path[i]);
+        if (it == nullptr) continue;
+
+        pathLine[i].position = sf::Vector2f{ it->x, it->y };
+        pathLine[i].color = colorset.path;
+    }
+
+    target.draw(pathLine);
+    CB_PROFILE_DRAW(pathLine.getVertexCount());
+}
+
+void BoardRenderer::drawChips(sf::RenderTarget& target, const BoardSnapshot& frame) const
+{
+    if (!frame.textures) return;
+    CB_PROFILE_SCOPE("chips");
+    const Level& level = *frame.level;
+    const DragState& drag = frame.drag;
+    for (uint32_t index : visible)
+    {
+        const int occupant = frame.chipAt(level.honeycombNode[index]);
+        if (occupant == -1) continue;
+        const ChipView& chip = frame.chips[occupant];
+
+        if (chip.moving || (drag.active && chip.uid == drag.uid)) continue;
+
+        const Node* position = level.puzzle.findNode(chip.position);
+        if (position == nullptr) continue;
+
+        auto texture = frame.textures->chips.find(chip.uid);
+        if (texture == frame.textures->chips.end()) continue;
+
+        sf::Sprite sprite{ *texture->second };
+
+        sf::FloatRect bounds{ sprite.getLocalBounds() };
+        const float scale = chipScale * spriteScale(*texture->second);
+        sprite.setOrigin(sf::Vector2f{ bounds.size.x / 2.0f, bounds.size.y / 2.0f });
+        sprite.setPosition(sf::Vector2f{ position->x, position->y });
+        sprite.setScale(sf::Vector2f{ scale, scale });
+
+        target.draw(sprite);
+        CB_PROFILE_DRAW(4);
+    }
+}
+
+void BoardRenderer::drawDraggedChip(sf::RenderTarget& target, const BoardSnapshot& frame) const
+{
+    const DragState& drag = frame.drag;
+    if (!drag.active || !frame.textures) return;
+    CB_PROFILE_SCOPE("draggedChip");
+
+    const Level& level = *frame.level;
+    auto it = frame.textures->chips.find(drag.uid);
+    if (it == frame.textures->chips.end()) return;
+
+    sf::Sprite sprite{ *it->second };
+    const float size = chipScale * spriteScale(*it->second);
+    sprite.setOrigin({ sprite.getLocalBounds().size.x * 0.5f, sprite.getLocalBounds().size.y * 0.5f });
+    sf::Vector2f pos = drag.mousePosition - drag.offset;
+    if (drag.target != -1)
+    {
+        if (const Node* pt = level.puzzle.findNode(drag.target))
+            pos = { pt->x, pt->y };
+    }
+
+    sprite.setColor(colorset.selected);
+    sprite.setScale({ size, size });
+    sprite.setPosition(pos);
+    target.draw(sprite);
+    CB_PROFILE_DRAW(4);
+}
+
+// Every animating chip with its trail. Each chip has a texture of its own,
+// so a chip's trail and sprite go out as one batch of quads in one draw
+// rather than a sprite per trail step.
+void BoardRenderer::drawMotions(sf::RenderTarget& target, const BoardSnapshot& frame)
+{
+    if (frame.motions.empty() || !frame.textures) return;
+    CB_PROFILE_SCOPE("motions");
+
+    for (const ChipMotion& motion : frame.motions)
+    {
+        auto it = frame.textures->chips.find(motion.uid);
+        if (it == frame.textures->chips.end()) continue;
+        const sf::Texture& texture = *it->second;
+        const sf::Vector2f textureSize{ texture.getSize() };
+        const float size = chipScale * spriteScale(texture);
+
+        auto quad = [&](sf::Vector2f centre, float scale, sf::Color color) {
+            const sf::Vector2f half = textureSize * (0.5f * scale);
+            const sf::Vector2f corners[] = { { -1.0f, -1.0f }, { 1.0f, -1.0f }, { 1.0f, 1.0f }, { -1.0f, 1.0f } };
+            for (int i : { 0, 1, 2, 0, 2, 3 })
+            {
+                const sf::Vector2f corner = corners[i];
+                const sf::Vector2f texCoords{ (corner.x + 1.0f) * 0.5f * textureSize.x, (corner.y + 1.0f) * 0.5f * textureSize.y };
+                motionBatch.append(sf::Vertex{ centre + sf::Vector2f{ corner.x * half.x, corner.y * half.y }, color, texCoords });
+            }
+        };
+
+        motionBatch.clear();
+        const float alpha = 128.0f * motion.fade;
+        for (uint32_t i = motion.trailCount; i-- > 0;)     // oldest underneath
+        {
+            const float age = static_cast<float>(i) / AnimationScheduler::trailSteps;
+            quad(frame.trail[motion.trailStart + i], size * (1.0f - age), sf::Color(255, 255, 255, static_cast<uint8_t>(alpha)));
+        }
+        quad(motion.position, size, motion.rejected ? colorset.error : sf::Color::White);
+
+        target.draw(motionBatch, sf::RenderStates{ &texture });
+        CB_PROFILE_DRAW(motionBatch.getVertexCount());
+    }
+}
+
+void BoardRenderer::drawHints(sf::RenderTarget& target, const BoardSnapshot& frame) const
+{
+    if (!frame.textures) return;
+    CB_PROFILE_SCOPE("hints");
+    const Level& level = *frame.level;
+    for (uint32_t index : visible)
+    {
+        auto hint = level.hintAt.find(level.honeycombNode[index]);
+        if (hint == level.hintAt.end()) continue;
+
+        const std::size_t i = hint->second;
+        if (i >= frame.chips.size()) continue;
+
+        const int targetId = level.puzzle.getTargets()[i];
+        const ChipView& chip = frame.chips[i];
+
+        const Node* itPoint = level.puzzle.findNode(targetId);
+        auto itTexture = frame.textures->hints.find(chip.uid);
+
+        if (itPoint == nullptr || itTexture == frame.textures->hints.end()) continue;
+
+        const sf::Vector2f pos
+        {
+            static_cast<float>(itPoint->x),
+            static_cast<float>(itPoint->y) + ((itPoint->y < level.hintCenterY) ? -64.0f : +64.0f)
+        };
+
+        sf::Sprite sprite{ *itTexture->second };
+        const sf::FloatRect bounds = sprite.getLocalBounds();
+
+        sprite.setOrigin(sf::Vector2f{ bounds.size.x / 2.0f, bounds.size.y / 2.0f });
+        sprite.setPosition(pos);
+        const float scale = hintScale * spriteScale(*itTexture->second);
+        sprite.setScale(sf::Vector2f{ scale, scale });
+        sprite.setColor(chip.position == targetId ? colorset.activeHint : colorset.inactiveHint);
+
+        target.draw(sprite);
+        CB_PROFILE_DRAW(4);
+    }
+}
+
+void BoardRenderer::drawSuggestion(sf::RenderTarget& target, const BoardSnapshot& frame)
+{
+    if (frame.suggestion.empty()) return;
+    CB_PROFILE_SCOPE("suggestion");
+
+    sf::VertexArray& line = suggestionLine;
+    line.resize(frame.suggestion.size());
+    for (std::size_t i = 0; i < frame.suggestion.size(); ++i)
+    {
+        const Node& pt = frame.level->puzzle.node(frame.suggestion[i]);
+        line[i].position = sf::Vector2f{ pt.x, pt.y };
+        line[i].color = colorset.activeHint;
+    }
+    target.draw(line);
+    CB_PROFILE_DRAW(line.getVertexCount());
+
+    suggestionRing.setOutlineColor(colorset.activeHint);
+    suggestionRing.setPosition(line[frame.suggestion.size() - 1].position);
+    target.draw(suggestionRing);
+    CB_PROFILE_DRAW(suggestionRing.getPointCount() * 2);
+}
+
+void BoardRenderer::drawButtons(sf::RenderTarget& target, const BoardSnapshot& frame)
+{
+    CB_PROFILE_SCOPE("buttons");
+    for (const ButtonView& button : frame.buttons)
+    {
+        buttonRect.setSize(button.size);
+        buttonRect.setPosition(button.position);
+        buttonRect.setFillColor(button.color);
+        target.draw(buttonRect);
+        CB_PROFILE_DRAW(4);
+    }
+}
+
+void BoardRenderer::drawSelection(sf::RenderTarget& target, const BoardSnapshot& frame)
+{
+    if (!frame.editor.selected) return;
+    selectionRing.setPosition(frame.editor.selection);
+    selectionRing.setOutlineColor(colorset.selected);
+    selectionRing.setOutlineThickness(3.0f * frame.zoom);
+    target.draw(selectionRing);
+    CB_PROFILE_DRAW(selectionRing.getPointCount() * 6);
+}
+
+// A strip along the top edge in the colour of the solvability verdict
+void BoardRenderer::drawEditStatus(sf::RenderTarget& target, const BoardSnapshot& frame)
+{
+    if (!frame.editor.active) return;
+    statusStrip.setSize(sf::Vector2f{ target.getView().getSize().x, 4.0f });
+    statusStrip.setFillColor(frame.editor.status);
+    target.draw(statusStrip);
+    CB_PROFILE_DRAW(4);
+}
+
+// Identicons are baked at whatever resolution the zoom called for; this
+// brings any of them back to the chip's size in world units.
+float BoardRenderer::spriteScale(const sf::Texture& texture)
+{
+    return Level::chipDiameter * identiconCanvas / static_cast<float>(texture.getSize().x);
+}
+
+void BoardRenderer::drawProfiler(sf::RenderTarget& target, const BoardSnapshot& frame) const
+{
+#ifdef CB_PROFILING
+    const profile::Untracked untracked;         // the overlay's text isn't part of the frame
+    const profile::FrameStats stats = profile::Profiler::instance().stats();
+
+    std::ostringstream out;
+    out << std::fixed << std::setprecision(2);
+    out << "frame " << stats.frameMilliseconds << " ms\n";
+    for (const profile::Phase& phase : stats.phases)
+        out << std::setw(16) << std::left << phase.name << std::right << std::setw(7) << phase.milliseconds << " ms\n";
+    out << "draws " << stats.drawCalls << "  verts " << stats.vertices << "\n";
+    out << "allocs " << stats.allocations << "\n";
+    constexpr double megabyte = 1 << 20;
+    out << "gpu tex " << frame.memory.textures / megabyte << "  vbo " << frame.memory.vertexBuffers / megabyte
+        << "  bake " << frame.memory.baking / megabyte << " MB";
+
+    sf::Text text{ uiFont, out.str(), 11 };
+    text.setFillColor(hexColor(color::Material::Foreground));
+    text.setOutlineColor(colorset.background);
+    text.setOutlineThickness(1.0f);
+    text.setPosition(sf::Vector2f{ 20.0f, 45.0f });
+    target.draw(text);
+#else
+    (void)target;
+    (void)frame;
+#endif
+}
+
+}
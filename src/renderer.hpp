@@ -0,0 +1,65 @@
+#pragma once
+#include <SFML/Graphics.hpp>
+#include <cstdint>
+#include <memory>
+#include <vector>
+#include "level.hpp"
+#include "snapshot.hpp"
+
+namespace cb {
+
+// Draws a board snapshot. Reads nothing but the snapshot and its level, so
+// it can run on a thread of its own while the board takes the next input.
+class BoardRenderer
+{
+    public:
+        BoardRenderer(const Colorset&, bool headless = false);
+        void draw(sf::RenderTarget&, const BoardSnapshot&, bool debug);
+        // Shader glow around cells: width in cell radii past the edge (up
+        // to Honeycomb::glowReach), intensity scales its alpha. Takes effect
+        // on the next frame, nothing is rebaked.
+        void setGlow(float width, float intensity) { glowWidth = width; glowIntensity = intensity; }
+
+    private:
+        void drawConnections(sf::RenderTarget&, const BoardSnapshot&, const sf::FloatRect&);
+        void drawHoneycombs(sf::RenderTarget&, const BoardSnapshot&, const sf::FloatRect&);
+        void drawPath(sf::RenderTarget&, const BoardSnapshot&);
+        void drawChips(sf::RenderTarget&, const BoardSnapshot&) const;
+        void drawHints(sf::RenderTarget&, const BoardSnapshot&) const;
+        void drawDraggedChip(sf::RenderTarget&, const BoardSnapshot&) const;
+        void drawMotions(sf::RenderTarget&, const BoardSnapshot&);
+        void drawSuggestion(sf::RenderTarget&, const BoardSnapshot&);
+        void drawButtons(sf::RenderTarget&, const BoardSnapshot&);
+        void drawSelection(sf::RenderTarget&, const BoardSnapshot&);
+        void drawEditStatus(sf::RenderTarget&, const BoardSnapshot&);
+        void drawProfiler(sf::RenderTarget&, const BoardSnapshot&) const;
+        static float spriteScale(const sf::Texture&);
+
+        const Colorset& colorset;
+        sf::Font uiFont;
+        float chipScale = 1.0f;
+        float hintScale = 1.0f;
+        sf::Texture connectionGradient;                 // see PolyLine
+        std::unique_ptr<sf::Shader> hexGlow;            // null without shader support
+        float glowWidth = 0.125f;
+        float glowIntensity = 1.0f;
+
+        static constexpr float cullMargin = 128.0f;     // chip/hint sprites reach past their node
+        std::vector<uint32_t> visible;
+
+        // Rebuilt every frame; kept as members so their storage is reused
+        sf::VertexArray pathLine{ sf::PrimitiveType::LineStrip };
+        sf::VertexArray suggestionLine{ sf::PrimitiveType::LineStrip };
+        sf::VertexArray motionBatch{ sf::PrimitiveType::Triangles };
+
+        // A shape builds its vertices on the heap whenever it is made, so
+        // these are made once and only moved and recoloured per frame
+        static constexpr float suggestionRadius = 28.0f;
+        static constexpr float selectionRadius = 30.0f;
+        sf::CircleShape suggestionRing{ suggestionRadius };
+        sf::CircleShape selectionRing{ selectionRadius };
+        sf::RectangleShape buttonRect;
+        sf::RectangleShape statusStrip;
+};
+
+}
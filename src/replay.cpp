@@ -0,0 +1,272 @@
+#include "replay.hpp"
+#include <chrono>
+#include <cstring>
+#include <iostream>
+#include <iterator>
+#include "board.hpp"
+
+namespace cb {
+
+namespace {
+
+constexpr char magic[4] = { 'C', 'B', 'R', 'L' };
+constexpr uint8_t version = 1;
+
+void writeVarint(std::ostream& out, uint64_t value)
+{
+    while (value >= 0x80)
+    {
+        out.put(static_cast<char>((value & 0x7F) | 0x80));
+        value >>= 7;
+    }
+    out.put(static_cast<char>(value));
+}
+
+void writeU32(std::ostream& out, uint32_t value)
+{
+    for (int shift = 0; shift < 32; shift += 8) out.put(static_cast<char>((value >> shift) & 0xFF));
+}
+
+void writeFloat(std::ostream& out, float value)
+{
+    uint32_t bits;
+    std::memcpy(&bits, &value, sizeof bits);
+    writeU32(out, bits);
+}
+
+class Reader
+{
+    public:
+        Reader(const std::vector<char>& data): data(data) {}
+
+        bool done() const { return cursor >= data.size(); }
+        bool ok() const { return !failed; }
+
+        uint8_t byte()
+        {
+            if (cursor >= data.size()) { failed = true; return 0; }
+            return static_cast<uint8_t>(data[cursor++]);
+        }
+
+        uint64_t varint()
+        {
+            uint64_t value = 0;
+            for (int shift = 0; shift < 64; shift += 7)
+            {
+                const uint8_t b = byte();
+                value |= static_cast<uint64_t>(b & 0x7F) << shift;
+                if (!(b & 0x80)) break;
+            }
+            return value;
+        }
+
+        uint64_t u64()
+        {
+            uint64_t value = 0;
+            for (int shift = 0; shift < 64; shift += 8) value |= static_cast<uint64_t>(byte()) << shift;
+            return value;
+        }
+
+        float f32()
+        {
+            uint32_t bits = 0;
+            for (int shift = 0; shift < 32; shift += 8) bits |= static_cast<uint32_t>(byte()) << shift;
+            float value;
+            std::memcpy(&value, &bits, sizeof value);
+            return value;
+        }
+
+        std::string text(std::size_t length)
+        {
+            if (length > data.size() - cursor) { failed = true; return {}; }
+            std::string value(data.data() + cursor, length);
+            cursor += length;
+            return value;
+        }
+
+    private:
+        const std::vector<char>& data;
+        std::size_t cursor = 0;
+        bool failed = false;
+};
+
+}
+
+bool InputRecorder::open(const std::string& filename)
+{
+    file.open(filename, std::ios::binary | std::ios::trunc);
+    if (!file.is_open())
+    {
+        std::cerr << "Failed to open input log: " << filename << "\n";
+        return false;
+    }
+    file.write(magic, sizeof magic);
+    file.put(static_cast<char>(version));
+    lastTime = 0;
+    return true;
+}
+
+void InputRecorder::record(const InputEvent& event)
+{
+    if (!file.is_open()) return;
+
+    file.put(static_cast<char>(event.type));
+    writeVarint(file, static_cast<uint64_t>(std::max<int64_t>(event.time - lastTime, 0)));
+    lastTime = std::max(lastTime, event.time);
+
+    switch (event.type)
+    {
+        case InputEvent::Frame:
+            writeFloat(file, event.value);
+            break;
+        case InputEvent::MouseDown:
+        case InputEvent::MouseMove:
+        case InputEvent::Pan:
+        case InputEvent::Resize:
+            writeFloat(file, event.position.x);
+            writeFloat(file, event.position.y);
+            break;
+        case InputEvent::Zoom:
+            writeFloat(file, event.position.x);
+            writeFloat(file, event.position.y);
+            writeFloat(file, event.value);
+            break;
+        case InputEvent::Level:
+            file.put(event.external ? 1 : 0);
+            writeVarint(file, event.source.size());
+            file.write(event.source.data(), static_cast<std::streamsize>(event.source.size()));
+            break;
+        case InputEvent::End:
+            writeU32(file, static_cast<uint32_t>(event.hash));
+            writeU32(file, static_cast<uint32_t>(event.hash >> 32));
+            break;
+        case InputEvent::MouseUp:
+        case InputEvent::ResetView:
+            break;
+    }
+}
+
+void InputRecorder::close(uint64_t finalHash)
+{
+    if (!file.is_open()) return;
+    InputEvent end;
+    end.type = InputEvent::End;
+    end.time = lastTime;
+    end.hash = finalHash;
+    record(end);
+    file.close();
+}
+
+std::optional<std::vector<InputEvent>> readInputLog(const std::string& filename)
+{
+    std::ifstream file(filename, std::ios::binary);
+    if (!file.is_open())
+    {
+        std::cerr << "Failed to open input log: " << filename << "\n";
+        return std::nullopt;
+    }
+    const std::vector<char> data{ std::istreambuf_iterator<char>(file), std::istreambuf_iterator<char>() };
+
+    Reader in(data);
+    for (char c : magic)
+    {
+        if (static_cast<char>(in.byte()) != c)
+        {
+            std::cerr << "Not an input log: " << filename << "\n";
+            return std::nullopt;
+        }
+    }
+    if (in.byte() != version)
+    {
+        std::cerr << "Unsupported input log version: " << filename << "\n";
+        return std::nullopt;
+    }
+
+    std::vector<InputEvent> events;
+    int64_t time = 0;
+    while (!in.done() && in.ok())
+    {
+        InputEvent event;
+        event.type = static_cast<InputEvent::Type>(in.byte());
+        time += static_cast<int64_t>(in.varint());
+        event.time = time;
+
+        switch (event.type)
+        {
+            case InputEvent::Frame:
+                event.value = in.f32();
+                break;
+            case InputEvent::MouseDown:
+            case InputEvent::MouseMove:
+            case InputEvent::Pan:
+            case InputEvent::Resize:
+                event.position.x = in.f32();
+                event.position.y = in.f32();
+                break;
+            case InputEvent::Zoom:
+                event.position.x = in.f32();
+                event.position.y = in.f32();
+                event.value = in.f32();
+                break;
+            case InputEvent::Level:
+                event.external = in.byte() != 0;
+                event.source = in.text(static_cast<std::size_t>(in.varint()));
+                break;
+            case InputEvent::End:
+                event.hash = in.u64();
+                break;
+            case InputEvent::MouseUp:
+            case InputEvent::ResetView:
+                break;
+            default:
+                std::cerr << "Corrupt input log: " << filename << "\n";
+                return std::nullopt;
+        }
+        events.push_back(std::move(event));
+    }
+
+    if (!in.ok())
+    {
+        std::cerr << "Truncated input log: " << filename << "\n";
+        return std::nullopt;
+    }
+    return events;
+}
+
+void applyInput(Board& board, const InputEvent& event)
+{
+    switch (event.type)
+    {
+        case InputEvent::Frame:     board.update(event.value); break;
+        case InputEvent::MouseDown: board.mouseDown(event.position); break;
+        case InputEvent::MouseMove: board.mouseMove(event.position); break;
+        case InputEvent::MouseUp:   board.mouseUp(); break;
+        case InputEvent::Pan:       board.pan(event.position); break;
+        case InputEvent::Zoom:      board.zoom(event.position, event.value); break;
+        case InputEvent::ResetView: board.resetView(); break;
+        case InputEvent::Level:     board.loadLevelNow(event.source, event.external); break;
+        case InputEvent::Resize:    board.setWindowSize(event.position); break;
+        case InputEvent::End:       break;
+    }
+}
+
+ReplayResult replayHeadless(const std::vector<InputEvent>& events, const sf::Vector2f& wsize)
+{
+    Board board(wsize, true);
+    board.setScripted(true);
+
+    ReplayResult result;
+    const auto start = std::chrono::steady_clock::now();
+    for (const InputEvent& event : events)
+    {
+        if (event.type == InputEvent::End) result.expected = event.hash;
+        if (event.type == InputEvent::Frame) ++result.frames;
+        applyInput(board, event);
+        ++result.events;
+    }
+    result.seconds = std::chrono::duration<double>(std::chrono::steady_clock::now() - start).count();
+    result.hash = board.getPuzzle().hash();
+    return result;
+}
+
+}
@@ -0,0 +1,72 @@
+#pragma once
+#include <SFML/Graphics.hpp>
+#include <cstdint>
+#include <fstream>
+#include <optional>
+#include <string>
+#include <vector>
+
+namespace cb {
+
+class Board;
+
+// One input that changed the board, or one simulation step. Positions are
+// pixels of a window of the last Resize's size, or the board's own size
+// before any and floats are stored bit-exact, so feeding the same events
+// to a fresh Board reproduces the same final state.
+struct InputEvent
+{
+    enum Type : uint8_t
+    {
+        Frame,          // update(value)
+        MouseDown,
+        MouseMove,
+        MouseUp,
+        Pan,            // position = pixel delta
+        Zoom,           // position = anchor pixel, value = factor
+        ResetView,
+        Level,          // level became active: source, external
+        End,            // hash of the final puzzle state
+        Resize          // position = window size in pixels
+    };
+
+    Type type = Frame;
+    int64_t time = 0;   // microseconds since recording started
+    sf::Vector2f position;
+    float value = 0.0f;
+    std::string source;
+    bool external = false;
+    uint64_t hash = 0;
+};
+
+// Appends events to a compact binary log: a type byte, a varint time delta
+// and a type-specific payload.
+class InputRecorder
+{
+    public:
+        bool open(const std::string&);
+        void record(const InputEvent&);
+        void close(uint64_t finalHash);
+        bool isOpen() const { return file.is_open(); }
+
+    private:
+        std::ofstream file;
+        int64_t lastTime = 0;
+};
+
+std::optional<std::vector<InputEvent>> readInputLog(const std::string&);
+void applyInput(Board&, const InputEvent&);
+
+struct ReplayResult
+{
+    std::size_t events = 0;
+    std::size_t frames = 0;
+    double seconds = 0.0;
+    uint64_t hash = 0;
+    std::optional<uint64_t> expected;   // from the log's End event
+};
+
+// As fast as possible without a window or GL context.
+ReplayResult replayHeadless(const std::vector<InputEvent>&, const sf::Vector2f& wsize);
+
+}
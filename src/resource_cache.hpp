@@ -0,0 +1,113 @@
+#pragma once
+#include <SFML/Graphics.hpp>
+#include <algorithm>
+#include <cstddef>
+#include <cstdint>
+#include <memory>
+#include <mutex>
+#include <unordered_map>
+
+namespace cb {
+
+struct LevelMeshes;
+
+// Identicon textures and level meshes, shared by every board in the
+// process. Entries are weak: a resource lives as long as some level holds
+// it, and a level asking for the same one meanwhile gets that instead of
+// baking a copy, so boards showing the same level share their GPU memory.
+// Lookups may come from any loader thread.
+class ResourceCache
+{
+    public:
+        static ResourceCache& shared()
+        {
+            static ResourceCache cache;
+            return cache;
+        }
+
+        struct IdenticonKey
+        {
+            unsigned seed;
+            unsigned diameter;
+            bool background;
+            uint32_t color;                             // sf::Color::toInteger()
+
+            bool operator==(const IdenticonKey&) const = default;
+        };
+
+        // The live texture for key, or bake()'s result, which later callers
+        // then share. Baking runs outside the lock.
+        template<class Bake>
+        std::shared_ptr<sf::Texture> identicon(const IdenticonKey& key, Bake&& bake)
+        {
+            if (auto texture = find(textures, key)) return texture;
+            return publish(textures, key, bake());
+        }
+
+        // Keyed by Level::geometryKey(); null when no level holds that
+        // geometry. publish() returns the set to use, which is an existing
+        // one if another loader built the same geometry meanwhile. Keys are
+        // hashes: callers compare LevelMeshes::layout before sharing.
+        std::shared_ptr<LevelMeshes> meshes(uint64_t key) { return find(meshSets, key); }
+        std::shared_ptr<LevelMeshes> publish(uint64_t key, std::shared_ptr<LevelMeshes> built) { return publish(meshSets, key, std::move(built)); }
+
+        std::size_t textureCount() const { return live(textures); }
+        std::size_t meshSetCount() const { return live(meshSets); }
+
+    private:
+        struct IdenticonHash
+        {
+            std::size_t operator()(const IdenticonKey& key) const
+            {
+                const uint64_t h = (uint64_t{ key.seed } << 32 | uint64_t{ key.diameter } << 1 | key.background) ^ uint64_t{ key.color } * 0x9e3779b97f4a7c15ull;
+                return std::hash<uint64_t>{}(h);
+            }
+        };
+
+        template<class Key, class Value, class Hash = std::hash<Key>>
+        struct Table
+        {
+            std::unordered_map<Key, std::weak_ptr<Value>, Hash> entries;
+            std::size_t sweepAt = 64;                   // size at which expired entries are dropped
+        };
+
+        template<class Key, class Value, class Hash>
+        std::shared_ptr<Value> find(Table<Key, Value, Hash>& table, const Key& key)
+        {
+            std::lock_guard lock(mutex);
+            auto it = table.entries.find(key);
+            return it == table.entries.end() ? nullptr : it->second.lock();
+        }
+
+        template<class Key, class Value, class Hash>
+        std::shared_ptr<Value> publish(Table<Key, Value, Hash>& table, const Key& key, std::shared_ptr<Value> value)
+        {
+            if (!value) return value;
+            std::lock_guard lock(mutex);
+            std::weak_ptr<Value>& entry = table.entries[key];
+            if (auto existing = entry.lock()) return existing;
+            entry = value;
+
+            // Sweeping whenever the table doubles keeps it proportional to
+            // what is alive, at constant cost per insert
+            if (table.entries.size() >= table.sweepAt)
+            {
+                std::erase_if(table.entries, [](const auto& kv) { return kv.second.expired(); });
+                table.sweepAt = std::max<std::size_t>(64, 2 * table.entries.size());
+            }
+            return value;
+        }
+
+        template<class Key, class Value, class Hash>
+        std::size_t live(const Table<Key, Value, Hash>& table) const
+        {
+            std::lock_guard lock(mutex);
+            return static_cast<std::size_t>(std::count_if(table.entries.begin(), table.entries.end(), [](const auto& kv) { return !kv.second.expired(); }));
+        }
+
+        mutable std::mutex mutex;
+        Table<IdenticonKey, sf::Texture, IdenticonHash> textures;
+        Table<uint64_t, LevelMeshes> meshSets;
+};
+
+}
@@ -0,0 +1,130 @@
+#pragma once
+#include <SFML/Graphics.hpp>
+#include <array>
+#include <atomic>
+#include <cstdint>
+#include <memory>
+#include <vector>
+#include "level.hpp"
+
+namespace cb {
+
+// The chip the player is holding; once let go, its move is handed to the
+// animation scheduler.
+struct DragState
+{
+    bool active = false;
+    int uid = -1;
+    int origin = -1;
+    int target = -1;                            // hovered sector
+    bool resolved = true;                       // target and path match mousePosition
+    sf::Vector2f mousePosition;
+    std::vector<int> path;
+    sf::Vector2f offset;
+
+    // Back to idle, keeping the path buffer for the next drag
+    void reset()
+    {
+        active = false;
+        resolved = true;
+        uid = origin = target = -1;
+        path.clear();
+    }
+};
+
+struct ChipView
+{
+    int uid;
+    int position;
+    bool moving = false;                        // drawn from its motion instead
+};
+
+// Where a chip is drawn while a move animates, and the fading trail behind
+// it as a range of BoardSnapshot::trail, newest first.
+struct ChipMotion
+{
+    int uid = -1;
+    sf::Vector2f position;
+    bool rejected = false;                      // a move that didn't happen
+    float fade = 0.0f;                          // trail opacity, 0..1
+    uint32_t trailStart = 0;
+    uint32_t trailCount = 0;
+};
+
+struct ButtonView
+{
+    sf::Vector2f position;
+    sf::Vector2f size;
+    sf::Color color;
+};
+
+struct EditorView
+{
+    bool active = false;
+    bool selected = false;
+    sf::Vector2f selection;                     // world; follows a node being dragged
+    sf::Color status;                           // verdict of the last solvability check
+};
+
+// Everything a frame draws, copied out of the board after the frame's input
+// and simulation. The level is shared rather than copied: once swapped in,
+// the renderer reads only its geometry and node positions, none of which
+// change while it is live. Chip state and the texture set live here instead,
+// since the simulation keeps moving chips and rebaking identicons.
+struct BoardSnapshot
+{
+    std::shared_ptr<const Level> level;
+    std::shared_ptr<const TextureSet> textures; // null draws no chips or hints
+    std::vector<ChipView> chips;                // per chips index
+    std::vector<int32_t> occupant;              // per node uid - 1, chips index or -1
+    DragState drag;
+    std::vector<ChipMotion> motions;
+    std::vector<sf::Vector2f> trail;
+    std::vector<int> suggestion;                // route of the hinted move, empty for none
+    std::vector<ButtonView> buttons;
+    EditorView editor;
+    MemoryUsage memory;
+    sf::View view;
+    float zoom = 1.0f;
+    uint64_t sequence = 0;                      // bumped per capture
+    int64_t inputTime = -1;                     // oldest input it reflects, -1 for none
+
+    int chipAt(int node) const { return occupant[node - 1]; }
+};
+
+// Hands snapshots from the simulation thread to the render thread without
+// locks. Three slots rather than two: the writer fills its back slot while
+// the reader draws its front one, and the third holds the latest publish,
+// so neither side ever waits for the other. The reader may draw the same
+// snapshot twice, or skip some, but never sees one half written. Slots are
+// reused, so after a few frames capturing into them stops allocating.
+class SnapshotExchange
+{
+    public:
+        BoardSnapshot& back() { return slots[backIndex]; }
+
+        void publish()
+        {
+            backIndex = ready.exchange(backIndex | fresh, std::memory_order_acq_rel) & index;
+        }
+
+        // The latest published snapshot, or the previous one when nothing
+        // new has been published since.
+        const BoardSnapshot& acquire()
+        {
+            if (ready.load(std::memory_order_relaxed) & fresh)
+                frontIndex = ready.exchange(frontIndex, std::memory_order_acq_rel) & index;
+            return slots[frontIndex];
+        }
+
+    private:
+        static constexpr uint8_t index = 0x3;
+        static constexpr uint8_t fresh = 0x4;
+
+        std::array<BoardSnapshot, 3> slots;
+        std::atomic<uint8_t> ready{ 1 };
+        uint8_t backIndex = 0;                  // writer's thread only
+        uint8_t frontIndex = 2;                 // reader's thread only
+};
+
+}
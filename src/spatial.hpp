@@ -0,0 +1,162 @@
+#pragma once
+#include <SFML/Graphics.hpp>
+#include <cstdint>
+#include <vector>
+#include <algorithm>
+#include <cmath>
+#include <limits>
+
+namespace cb {
+
+// Uniform grid over item bounding boxes, stored as compressed rows
+// (cellStart/items) so a query only touches the cells under the rectangle.
+// Queries keep no state, so any number of threads may run them at once.
+class SpatialGrid
+{
+    public:
+        void build(const std::vector<sf::FloatRect>& bounds)
+        {
+            centres.clear();
+            cellStart.clear();
+            items.clear();
+            firstCell.clear();
+            if (bounds.empty()) return;
+
+            sf::Vector2f lo{ std::numeric_limits<float>::max(), std::numeric_limits<float>::max() };
+            sf::Vector2f hi{ std::numeric_limits<float>::lowest(), std::numeric_limits<float>::lowest() };
+            centres.reserve(bounds.size());
+            for (const sf::FloatRect& b : bounds)
+            {
+                lo = { std::min(lo.x, b.position.x), std::min(lo.y, b.position.y) };
+                hi = { std::max(hi.x, b.position.x + b.size.x), std::max(hi.y, b.position.y + b.size.y) };
+                centres.push_back(b.position + b.size * 0.5f);
+            }
+
+            // Roughly two items per cell, capped so the table stays small
+            const sf::Vector2f extent{ std::max(hi.x - lo.x, 1.0f), std::max(hi.y - lo.y, 1.0f) };
+            cell = std::sqrt(extent.x * extent.y * 2.0f / static_cast<float>(bounds.size()));
+            cell = std::max({ cell, extent.x / maxCells, extent.y / maxCells, 1.0f });
+            origin = lo;
+            cols = static_cast<int>(extent.x / cell) + 1;
+            rows = static_cast<int>(extent.y / cell) + 1;
+
+            cellStart.assign(static_cast<std::size_t>(cols) * rows + 1, 0);
+            forEachCell(bounds, [&](uint32_t, std::size_t c) { ++cellStart[c + 1]; });
+            for (std::size_t c = 1; c < cellStart.size(); ++c) cellStart[c] += cellStart[c - 1];
+
+            items.resize(cellStart.back());
+            std::vector<uint32_t> fill(cellStart.begin(), cellStart.end() - 1);
+            forEachCell(bounds, [&](uint32_t i, std::size_t c) { items[fill[c]++] = i; });
+
+            firstCell.resize(bounds.size());
+            for (uint32_t i = 0; i < bounds.size(); ++i)
+            {
+                int x1, y1;
+                cellRange(bounds[i], firstCell[i].x, firstCell[i].y, x1, y1);
+            }
+        }
+
+        // Appends every item whose cells overlap the rectangle, each once:
+        // an item spanning several of them is taken from the first only.
+        void query(const sf::FloatRect& rect, std::vector<uint32_t>& out) const
+        {
+            if (items.empty()) return;
+            int x0, y0, x1, y1;
+            cellRange(rect, x0, y0, x1, y1);
+            if (x0 > x1 || y0 > y1) return;
+
+            for (int y = y0; y <= y1; ++y)
+            {
+                for (int x = x0; x <= x1; ++x)
+                {
+                    const std::size_t c = static_cast<std::size_t>(y) * cols + x;
+                    for (uint32_t k = cellStart[c]; k < cellStart[c + 1]; ++k)
+                    {
+                        const uint32_t item = items[k];
+                        if (std::max(firstCell[item].x, x0) != x || std::max(firstCell[item].y, y0) != y) continue;
+                        out.push_back(item);
+                    }
+                }
+            }
+        }
+
+        // Item whose centre is closest to the point, searching outward ring by ring.
+        int nearest(const sf::Vector2f& point) const
+        {
+            if (items.empty()) return -1;
+
+            const int cx = std::clamp(static_cast<int>((point.x - origin.x) / cell), 0, cols - 1);
+            const int cy = std::clamp(static_cast<int>((point.y - origin.y) / cell), 0, rows - 1);
+            int best = -1;
+            float bestDist = std::numeric_limits<float>::max();
+
+            for (int ring = 0; ring <= std::max(cols, rows); ++ring)
+            {
+                // Every unvisited cell is at least (ring - 1) cells away
+                const float reach = (ring - 1) * cell;
+                if (best != -1 && ring > 0 && reach > 0.0f && reach * reach > bestDist) break;
+
+                for (int y = cy - ring; y <= cy + ring; ++y)
+                {
+                    if (y < 0 || y >= rows) continue;
+                    const bool edgeRow = (y == cy - ring || y == cy + ring);
+                    for (int x = cx - ring; x <= cx + ring; x += (edgeRow ? 1 : 2 * ring))
+                    {
+                        if (x >= 0 && x < cols)
+                        {
+                            const std::size_t c = static_cast<std::size_t>(y) * cols + x;
+                            for (uint32_t k = cellStart[c]; k < cellStart[c + 1]; ++k)
+                            {
+                                const sf::Vector2f d = centres[items[k]] - point;
+                                const float dist = d.x * d.x + d.y * d.y;
+                                if (dist < bestDist)
+                                {
+                                    bestDist = dist;
+                                    best = static_cast<int>(items[k]);
+                                }
+                            }
+                        }
+                        if (ring == 0) break;
+                    }
+                }
+            }
+            return best;
+        }
+
+        std::size_t size() const { return centres.size(); }
+
+        static constexpr float maxCells = 1024.0f;
+
+    private:
+        void cellRange(const sf::FloatRect& r, int& x0, int& y0, int& x1, int& y1) const
+        {
+            x0 = std::max(0, static_cast<int>(std::floor((r.position.x - origin.x) / cell)));
+            y0 = std::max(0, static_cast<int>(std::floor((r.position.y - origin.y) / cell)));
+            x1 = std::min(cols - 1, static_cast<int>(std::floor((r.position.x + r.size.x - origin.x) / cell)));
+            y1 = std::min(rows - 1, static_cast<int>(std::floor((r.position.y + r.size.y - origin.y) / cell)));
+        }
+
+        template <typename F>
+        void forEachCell(const std::vector<sf::FloatRect>& bounds, F&& f) const
+        {
+            for (uint32_t i = 0; i < bounds.size(); ++i)
+            {
+                int x0, y0, x1, y1;
+                cellRange(bounds[i], x0, y0, x1, y1);
+                for (int y = y0; y <= y1; ++y)
+                    for (int x = x0; x <= x1; ++x)
+                        f(i, static_cast<std::size_t>(y) * cols + x);
+            }
+        }
+
+        sf::Vector2f origin;
+        float cell = 1.0f;
+        int cols = 0;
+        int rows = 0;
+        std::vector<sf::Vector2f> centres;
+        std::vector<uint32_t> cellStart;
+        std::vector<uint32_t> items;
+        std::vector<sf::Vector2i> firstCell;            // per item, top left cell it covers
+};
+
+}
@@ -0,0 +1,249 @@
+// Solves every level in the given files or directories and reports optimal
+// move counts, search effort and timings.
+//
+//   cupboards_batch [--threads N] [--max-states N] [--json out.json] [--csv out.csv] <level or dir>...
+
+#include <algorithm>
+#include <chrono>
+#include <cstdio>
+#include <filesystem>
+#include <fstream>
+#include <future>
+#include <iomanip>
+#include <iostream>
+#include <stdexcept>
+#include <string>
+#include <thread>
+#include <vector>
+#include "core/puzzle.hpp"
+#include "core/solver.hpp"
+#include "core/thread_pool.hpp"
+#include "tools/level_files.hpp"
+
+namespace fs = std::filesystem;
+
+namespace {
+
+struct Report
+{
+    std::string file;
+    std::string error;          // parse or solver failure, empty otherwise
+    std::size_t nodes = 0;
+    std::size_t chips = 0;
+    cb::SolveResult result;
+};
+
+Report solveFile(const fs::path& path, const cb::SolveLimits& limits, cb::ThreadPool& pool)
+{
+    Report report;
+    report.file = path.string();
+    try
+    {
+        std::ifstream file(path);
+        if (!file.is_open()) throw std::runtime_error("cannot open file");
+        const cb::Puzzle puzzle = cb::Puzzle::parse(file);
+        report.nodes = puzzle.nodeCount();
+        report.chips = puzzle.getChips().size();
+        report.result = cb::solve(puzzle, limits, &pool);
+    }
+    catch (const std::exception& e)
+    {
+        report.error = e.what();
+    }
+    return report;
+}
+
+const char* statusName(const Report& report)
+{
+    if (!report.error.empty()) return "error";
+    switch (report.result.status)
+    {
+        case cb::SolveResult::Solved:       return "solved";
+        case cb::SolveResult::Unsolvable:   return "unsolvable";
+        case cb::SolveResult::LimitReached: return "limit";
+        case cb::SolveResult::Cancelled:    return "cancelled";
+    }
+    return "error";
+}
+
+std::string jsonString(const std::string& text)
+{
+    std::string out = "\"";
+    for (char c : text)
+    {
+        if (c == '"' || c == '\\') out += '\\';
+        if (static_cast<unsigned char>(c) < 0x20)
+        {
+            char escaped[8];
+            std::snprintf(escaped, sizeof escaped, "\\u%04x", c);
+            out += escaped;
+            continue;
+        }
+        out += c;
+    }
+    return out + "\"";
+}
+
+std::string csvField(const std::string& text)
+{
+    if (text.find_first_of(",\"\n") == std::string::npos) return text;
+    std::string out = "\"";
+    for (char c : text)
+    {
+        if (c == '"') out += '"';
+        out += c;
+    }
+    return out + "\"";
+}
+
+double percentile(std::vector<double> values, double p)
+{
+    if (values.empty()) return 0.0;
+    std::sort(values.begin(), values.end());
+    return values[static_cast<std::size_t>(p * (values.size() - 1) + 0.5)];
+}
+
+struct Summary
+{
+    const char* name;
+    std::vector<double> values;
+};
+
+std::vector<Summary> summarize(const std::vector<Report>& reports)
+{
+    std::vector<Summary> summary{ { "milliseconds", {} }, { "moves", {} }, { "expanded", {} }, { "peak_bytes", {} } };
+    for (const Report& report : reports)
+    {
+        if (!report.error.empty() || report.result.status != cb::SolveResult::Solved) continue;
+        summary[0].values.push_back(report.result.seconds * 1000.0);
+        summary[1].values.push_back(report.result.moves);
+        summary[2].values.push_back(static_cast<double>(report.result.expanded));
+        summary[3].values.push_back(static_cast<double>(report.result.peakBytes));
+    }
+    return summary;
+}
+
+constexpr double percentiles[] = { 0.5, 0.9, 0.99, 1.0 };
+constexpr const char* percentileNames[] = { "p50", "p90", "p99", "max" };
+
+void writeJson(std::ostream& out, const std::vector<Report>& reports, double wallSeconds, unsigned threads)
+{
+    out << "{\n  \"threads\": " << threads << ",\n  \"wall_seconds\": " << wallSeconds << ",\n  \"levels\": [\n";
+    for (std::size_t i = 0; i < reports.size(); ++i)
+    {
+        const Report& r = reports[i];
+        out << "    { \"file\": " << jsonString(r.file) << ", \"status\": \"" << statusName(r) << "\""
+            << ", \"nodes\": " << r.nodes << ", \"chips\": " << r.chips
+            << ", \"moves\": " << r.result.moves << ", \"expanded\": " << r.result.expanded
+            << ", \"states\": " << r.result.states << ", \"milliseconds\": " << r.result.seconds * 1000.0
+            << ", \"peak_bytes\": " << r.result.peakBytes;
+        if (!r.error.empty()) out << ", \"error\": " << jsonString(r.error);
+        out << " }" << (i + 1 < reports.size() ? "," : "") << "\n";
+    }
+    out << "  ],\n  \"summary\": {\n";
+
+    const std::vector<Summary> summary = summarize(reports);
+    for (std::size_t s = 0; s < summary.size(); ++s)
+    {
+        out << "    \"" << summary[s].name << "\": {";
+        for (std::size_t p = 0; p < std::size(percentiles); ++p)
+            out << (p ? ", " : " ") << "\"" << percentileNames[p] << "\": " << percentile(summary[s].values, percentiles[p]);
+        out << " }" << (s + 1 < summary.size() ? "," : "") << "\n";
+    }
+    out << "  }\n}\n";
+}
+
+void writeCsv(std::ostream& out, const std::vector<Report>& reports)
+{
+    out << "file,status,nodes,chips,moves,expanded,states,milliseconds,peak_bytes,error\n";
+    for (const Report& r : reports)
+    {
+        out << csvField(r.file) << "," << statusName(r) << "," << r.nodes << "," << r.chips << ","
+            << r.result.moves << "," << r.result.expanded << "," << r.result.states << ","
+            << r.result.seconds * 1000.0 << "," << r.result.peakBytes << "," << csvField(r.error) << "\n";
+    }
+}
+
+}
+
+int main(int argc, char* argv[])
+{
+    unsigned threads = std::max(std::thread::hardware_concurrency(), 1u);
+    cb::SolveLimits limits;
+    std::string jsonFile;
+    std::string csvFile;
+    std::vector<std::string> inputs;
+    for (int i = 1; i < argc; ++i)
+    {
+        const std::string arg{ argv[i] };
+        if (arg == "--threads" && i + 1 < argc) threads = static_cast<unsigned>(std::stoul(argv[++i]));
+        else if (arg == "--max-states" && i + 1 < argc) limits.maxStates = std::stoull(argv[++i]);
+        else if (arg == "--json" && i + 1 < argc) jsonFile = argv[++i];
+        else if (arg == "--csv" && i + 1 < argc) csvFile = argv[++i];
+        else inputs.push_back(arg);
+    }
+
+    const std::vector<fs::path> files = cb::collectLevels(inputs);
+    if (files.empty())
+    {
+        std::cerr << "usage: cupboards_batch [--threads N] [--max-states N] [--json file] [--csv file] <level or dir>...\n";
+        return 1;
+    }
+
+    // Largest files first so a long solve starts early instead of holding up
+    // the tail; its wide layers are split across whichever workers are idle.
+    std::vector<std::size_t> order(files.size());
+    for (std::size_t i = 0; i < order.size(); ++i) order[i] = i;
+    auto fileSize = [&](std::size_t i) {
+        std::error_code error;
+        const auto size = fs::file_size(files[i], error);
+        return error ? 0 : size;
+    };
+    std::stable_sort(order.begin(), order.end(), [&](std::size_t a, std::size_t b) { return fileSize(a) > fileSize(b); });
+
+    const auto started = std::chrono::steady_clock::now();
+    std::vector<Report> reports(files.size());
+    {
+        cb::ThreadPool pool(threads);
+        std::vector<std::future<Report>> pending;
+        pending.reserve(files.size());
+        for (std::size_t i : order)
+            pending.push_back(pool.submit([&, i] { return solveFile(files[i], limits, pool); }));
+        for (std::size_t k = 0; k < order.size(); ++k) reports[order[k]] = pending[k].get();
+    }
+    const double wallSeconds = std::chrono::duration<double>(std::chrono::steady_clock::now() - started).count();
+
+    std::size_t solved = 0;
+    for (const Report& r : reports)
+    {
+        std::cout << std::left << std::setw(12) << statusName(r) << r.file;
+        if (r.error.empty() && r.result.status == cb::SolveResult::Solved)
+        {
+            ++solved;
+            std::cout << "  " << r.result.moves << " moves, " << r.result.expanded << " expanded, "
+                      << r.result.seconds * 1000.0 << " ms";
+        }
+        if (!r.error.empty()) std::cout << "  " << r.error;
+        std::cout << "\n";
+    }
+    std::cout << solved << "/" << reports.size() << " solved in " << wallSeconds << " s on " << threads << " threads\n";
+    for (const Summary& s : summarize(reports))
+    {
+        std::cout << "  " << std::left << std::setw(14) << s.name;
+        for (std::size_t p = 0; p < std::size(percentiles); ++p)
+            std::cout << " " << percentileNames[p] << "=" << percentile(s.values, percentiles[p]);
+        std::cout << "\n";
+    }
+
+    if (!jsonFile.empty())
+    {
+        std::ofstream out(jsonFile);
+        writeJson(out, reports, wallSeconds, threads);
+    }
+    if (!csvFile.empty())
+    {
+        std::ofstream out(csvFile);
+        writeCsv(out, reports);
+    }
+    return solved == reports.size() ? 0 : 2;
+}
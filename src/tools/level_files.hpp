@@ -0,0 +1,37 @@
+#pragma once
+#include <algorithm>
+#include <filesystem>
+#include <string>
+#include <system_error>
+#include <vector>
+
+namespace cb {
+
+// Level files named on a tool's command line: files as given, directories
+// as packs whose regular files are taken in name order.
+inline std::vector<std::filesystem::path> collectLevels(const std::vector<std::string>& inputs)
+{
+    namespace fs = std::filesystem;
+    std::vector<fs::path> files;
+    for (const std::string& input : inputs)
+    {
+        std::error_code error;
+        if (fs::is_directory(input, error))
+        {
+            std::vector<fs::path> pack;
+            for (const auto& entry : fs::directory_iterator(input, error))
+            {
+                if (entry.is_regular_file()) pack.push_back(entry.path());
+            }
+            std::sort(pack.begin(), pack.end());
+            files.insert(files.end(), pack.begin(), pack.end());
+        }
+        else
+        {
+            files.emplace_back(input);
+        }
+    }
+    return files;
+}
+
+}
@@ -0,0 +1,227 @@
+// Renders a preview of every level in the given files or directories, as
+// one PNG per level plus atlas pages that pack them in a grid, with a CSV
+// index of where each level's cell is.
+//
+//   cupboards_thumbs [--size N] [--threads N] [--out dir] [--atlas-size N] <level or dir>...
+//
+// Parsing and geometry run on a worker pool a few levels ahead of the GL
+// thread, which bakes identicons and draws each board with the game's own
+// renderer; PNG encoding goes back to the pool.
+
+#include <algorithm>
+#include <chrono>
+#include <cmath>
+#include <deque>
+#include <filesystem>
+#include <fstream>
+#include <future>
+#include <iostream>
+#include <limits>
+#include <map>
+#include <memory>
+#include <string>
+#include <thread>
+#include <vector>
+#include <SFML/Graphics.hpp>
+#include "camera.hpp"
+#include "level.hpp"
+#include "renderer.hpp"
+#include "snapshot.hpp"
+#include "core/thread_pool.hpp"
+#include "tools/level_files.hpp"
+
+namespace fs = std::filesystem;
+
+namespace {
+
+// Identicons at the tier the game would bake for this zoom
+unsigned identiconResolution(float zoom)
+{
+    const float pixels = cb::Level::chipDiameter / zoom;
+    unsigned tier = 16;
+    while (tier < pixels && tier < 256) tier *= 2;
+    return tier;
+}
+
+// Draws the level in its starting layout, framed with room for the chips
+// on its edge. keep holds on to the identicons, so the next level, which
+// mostly has the same chip uids at the same tier, finds them in the
+// resource cache instead of baking them again.
+sf::Image renderThumbnail(const std::shared_ptr<cb::Level>& level, sf::RenderTexture& canvas, cb::BoardRenderer& renderer,
+                          const cb::Colorset& colorset, cb::IdenticonBaker& baker, std::shared_ptr<const cb::TextureSet>& keep)
+{
+    cb::Camera camera{ sf::Vector2f{ canvas.getSize() } };
+    camera.fit(level->boardBounds, cb::Level::chipDiameter);
+
+    level->requestResolution(identiconResolution(camera.getZoom()));
+    level->bakeTextures(baker, std::numeric_limits<float>::infinity());
+    keep = level->textures;
+
+    cb::BoardSnapshot frame;
+    frame.level = level;
+    frame.textures = level->textures;
+    for (const cb::Chip& chip : level->puzzle.getChips())
+        frame.chips.push_back(cb::ChipView{ static_cast<int>(chip.uid), chip.position });
+    frame.occupant = level->puzzle.getOccupants();
+    frame.view = camera.getView();
+    frame.zoom = camera.getZoom();
+
+    canvas.clear(colorset.background);
+    renderer.draw(canvas, frame, false);
+    canvas.display();
+    return canvas.getTexture().copyToImage();
+}
+
+// Cells in row order across pages of at most atlasSize pixels a side; the
+// last page is only as tall as its rows.
+struct Atlas
+{
+    unsigned cell;
+    unsigned columns;
+    std::size_t perPage;
+    std::size_t count;
+    std::vector<sf::Image> pages;
+
+    Atlas(unsigned cell, unsigned atlasSize, std::size_t count)
+        : cell(cell), columns(std::max(atlasSize / cell, 1u)), perPage(std::size_t{ columns } * columns), count(count)
+    {
+        for (std::size_t first = 0; first < count; first += perPage)
+        {
+            const std::size_t rows = (std::min(perPage, count - first) + columns - 1) / columns;
+            pages.emplace_back(sf::Vector2u{ columns * cell, static_cast<unsigned>(rows) * cell }, sf::Color::Transparent);
+        }
+    }
+
+    std::size_t page(std::size_t index) const { return index / perPage; }
+
+    sf::Vector2u position(std::size_t index) const
+    {
+        const std::size_t local = index % perPage;
+        return sf::Vector2u{ static_cast<unsigned>(local % columns) * cell, static_cast<unsigned>(local / columns) * cell };
+    }
+};
+
+// Output names from the level file names, numbered where two packs share one
+std::vector<std::string> thumbnailNames(const std::vector<fs::path>& files)
+{
+    std::vector<std::string> names;
+    std::map<std::string, int> uses;
+    for (const fs::path& file : files)
+    {
+        const std::string stem = file.stem().string();
+        const int use = uses[stem]++;
+        names.push_back(use == 0 ? stem : stem + "-" + std::to_string(use));
+    }
+    return names;
+}
+
+}
+
+int main(int argc, char* argv[])
+{
+    unsigned threads = std::max(std::thread::hardware_concurrency(), 1u);
+    unsigned size = 128;
+    unsigned atlasSize = 4096;
+    fs::path outDir = "thumbs";
+    std::vector<std::string> inputs;
+    for (int i = 1; i < argc; ++i)
+    {
+        const std::string arg{ argv[i] };
+        if (arg == "--threads" && i + 1 < argc) threads = static_cast<unsigned>(std::stoul(argv[++i]));
+        else if (arg == "--size" && i + 1 < argc) size = static_cast<unsigned>(std::stoul(argv[++i]));
+        else if (arg == "--atlas-size" && i + 1 < argc) atlasSize = static_cast<unsigned>(std::stoul(argv[++i]));
+        else if (arg == "--out" && i + 1 < argc) outDir = argv[++i];
+        else inputs.push_back(arg);
+    }
+
+    const std::vector<fs::path> files = cb::collectLevels(inputs);
+    if (files.empty() || size == 0)
+    {
+        std::cerr << "usage: cupboards_thumbs [--size N] [--threads N] [--out dir] [--atlas-size N] <level or dir>...\n";
+        return 1;
+    }
+
+    std::error_code error;
+    fs::create_directories(outDir, error);
+    if (error)
+    {
+        std::cerr << "Cannot create " << outDir.string() << ": " << error.message() << "\n";
+        return 1;
+    }
+
+    cb::Honeycomb::setShaderGlow(sf::Shader::isAvailable());
+    sf::ContextSettings settings;
+    settings.antiAliasingLevel = 4;
+    sf::RenderTexture canvas;
+    if (!canvas.resize({ size, size }, settings))
+    {
+        std::cerr << "Cannot create a " << size << "x" << size << " render texture\n";
+        return 1;
+    }
+
+    const auto started = std::chrono::steady_clock::now();
+    const cb::Colorset colorset;
+    cb::BoardRenderer renderer(colorset);
+    cb::IdenticonBaker baker;
+    const std::vector<std::string> names = thumbnailNames(files);
+    Atlas atlas(size, atlasSize, files.size());
+    std::vector<bool> rendered(files.size(), false);
+
+    cb::ThreadPool pool(threads);
+    const sf::Vector2f screen{ static_cast<float>(size), static_cast<float>(size) };
+    auto load = [&](std::size_t i) {
+        return pool.submit([&, i] { return cb::Level::load(files[i].string(), true, screen, colorset); });
+    };
+
+    // Bounded lookahead keeps memory flat however large the pack is
+    std::deque<std::future<std::shared_ptr<cb::Level>>> loading;
+    std::size_t next = 0;
+    const std::size_t lookahead = 2 * std::size_t{ pool.size() };
+    while (next < files.size() && loading.size() < lookahead) loading.push_back(load(next++));
+
+    std::vector<std::future<bool>> writes;
+    std::shared_ptr<const cb::TextureSet> keep;
+    for (std::size_t i = 0; i < files.size(); ++i)
+    {
+        std::shared_ptr<cb::Level> level = loading.front().get();
+        loading.pop_front();
+        if (next < files.size()) loading.push_back(load(next++));
+        if (!level)
+        {
+            std::cerr << "Skipped " << files[i].string() << "\n";
+            continue;
+        }
+
+        sf::Image image = renderThumbnail(level, canvas, renderer, colorset, baker, keep);
+        (void)atlas.pages[atlas.page(i)].copy(image, atlas.position(i));
+        rendered[i] = true;
+
+        const fs::path path = outDir / (names[i] + ".png");
+        writes.push_back(pool.submit([image = std::move(image), path] { return image.saveToFile(path); }));
+    }
+
+    for (std::size_t p = 0; p < atlas.pages.size(); ++p)
+    {
+        const fs::path path = outDir / ("atlas-" + std::to_string(p) + ".png");
+        writes.push_back(pool.submit([&atlas, p, path] { return atlas.pages[p].saveToFile(path); }));
+    }
+
+    std::ofstream index(outDir / "atlas.csv");
+    index << "name,file,page,x,y,size\n";
+    for (std::size_t i = 0; i < files.size(); ++i)
+    {
+        if (!rendered[i]) continue;
+        const sf::Vector2u at = atlas.position(i);
+        index << names[i] << "," << files[i].string() << "," << atlas.page(i) << "," << at.x << "," << at.y << "," << size << "\n";
+    }
+
+    std::size_t failedWrites = 0;
+    for (std::future<bool>& write : writes) failedWrites += write.get() ? 0 : 1;
+    const std::size_t count = static_cast<std::size_t>(std::count(rendered.begin(), rendered.end(), true));
+    const double wallSeconds = std::chrono::duration<double>(std::chrono::steady_clock::now() - started).count();
+
+    std::cout << count << "/" << files.size() << " thumbnails, " << atlas.pages.size() << " atlas pages in "
+              << outDir.string() << ", " << wallSeconds << " s on " << threads << " threads\n";
+    if (failedWrites > 0) std::cerr << failedWrites << " images failed to write\n";
+    return count == files.size() && failedWrites == 0 ? 0 : 2;
+}
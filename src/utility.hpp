@@ -29,3 +29,9 @@ inline float easeOutBounce(float t)
 {
     return std::sqrt(1.0f - std::pow(t - 1.0f, 2));
 }
+
+// Starts and stops at rest, so moves queued back to back run on smoothly
+inline float easeInOutCubic(float t)
+{
+    return t < 0.5f ? 4.0f * t * t * t : 1.0f - std::pow(-2.0f * t + 2.0f, 3) / 2.0f;
+}